@@ -24,6 +24,11 @@ struct ArgConfig {
     bool quiet;
     bool verbose;
     bool no_cache;
+    std::string cache_dir;
+    int cache_budget;  // MB. -1: no limit.
+    int max_memory;    // MB. 0: no limit.
+    bool incremental;
+    bool depfile;
     int tz_seconds;
     int jobs;
     std::vector<std::string> targets;
@@ -36,7 +41,12 @@ struct ArgConfig {
               yaml_search_paths(),
               output_base_path("."),
               quiet(false),
+              verbose(false),
               no_cache(false),
+              cache_budget(2048),
+              max_memory(0),
+              incremental(false),
+              depfile(false),
               tz_seconds(utils::dateutil::local_tz_seconds()),
               jobs(std::thread::hardware_concurrency()) {
         name = argc > 0 ? argv[0] : "";
@@ -81,6 +91,24 @@ struct ArgConfig {
                 } else if (arg == "--no_cache") {
                     no_cache = true;
                     continue;
+                } else if (arg == "--incremental") {
+                    incremental = true;
+                    continue;
+                } else if (arg == "--depfile") {
+                    depfile = true;
+                    continue;
+                } else if (arg == "--cache_budget" && !last) {
+                    auto s = *++it;
+                    cache_budget = s == "none" ? -1 : std::stoi(s);
+                    cache_budget = cache_budget < -1 ? -1 : cache_budget;
+                    continue;
+                } else if (arg == "--max_memory" && !last) {
+                    max_memory = std::stoi(*++it);
+                    max_memory = max_memory < 0 ? 0 : max_memory;
+                    continue;
+                } else if (arg == "--cache_dir" && !last) {
+                    cache_dir = *++it;
+                    continue;
                 } else if (arg == "--timezone" && !last) {
                     auto s = *++it;
                     bool ok; int h, m; size_t p;
@@ -109,6 +137,11 @@ struct ArgConfig {
             "xlsxconverter (rev."  << BUILD_REVISION << ")" << std::endl <<
             usage  << " [--quiet]" << std::endl <<
             indent << " [--no_cache]" << std::endl <<
+            indent << " [--cache_dir <path>]" << std::endl <<
+            indent << " [--cache_budget <'none'|megabytes>]" << std::endl <<
+            indent << " [--max_memory <megabytes>]" << std::endl <<
+            indent << " [--incremental]" << std::endl <<
+            indent << " [--depfile]" << std::endl <<
             indent << " [--jobs <'full'|'half'|'quarter'|int>]" << std::endl <<
             indent << " [--xls_search_path <path>]" << std::endl <<
             indent << " [--yaml_search_path <paths>]" << std::endl <<
@@ -7,6 +7,8 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <memory>
+#include <deque>
+#include <future>
 
 #include "xlsx.hpp"
 #include "utils.hpp"
@@ -68,12 +70,74 @@ struct Converter {
     }
 
     static inline
-    std::shared_ptr<xlsx::Workbook> open_workbook(const std::string& path, bool using_cache) {
+    utils::shared_cache<std::string, xlsx::Workbook>& workbook_cache() {
+        // workbooks shared by targets, by path. csv/tsv sources by delimiter + path.
+        static utils::shared_cache<std::string, xlsx::Workbook> cache;
+        return cache;
+    }
+
+    static inline
+    size_t& workbook_cache_budget() {
+        // bytes of idle workbooks kept. least recently used ones over it are freed.
+        static size_t budget = static_cast<size_t>(2048) << 20;
+        return budget;
+    }
+
+    static inline
+    std::shared_ptr<xlsx::Workbook> open_workbook(const std::string& path, char delimiter,
+                                                  bool using_cache) {
+        // delimiter: csv or tsv source. 0: xlsx or xlsb.
         if (!using_cache) {
+            if (delimiter != 0) return std::make_shared<xlsx::Workbook>(path, delimiter);
             return std::make_shared<xlsx::Workbook>(path);
         }
-        static utils::shared_cache<std::string, xlsx::Workbook> cache;
-        return cache.get_or_emplace(path, path);
+        std::shared_ptr<xlsx::Workbook> book;
+        if (delimiter != 0) {
+            book = workbook_cache().get_or_emplace(delimiter + path, path, delimiter);
+        } else {
+            book = workbook_cache().get_or_emplace(path, path);
+        }
+        trim_workbook_cache();
+        return book;
+    }
+
+    static inline
+    size_t estimate_memory(const std::string& path, char delimiter) {
+        // decoded footprint of a workbook, before it is opened: the size of its sheets and
+        // shared strings inflated. only the zip central directory is read.
+        // 0 if it cant be read. opening it reports why.
+        struct stat statbuf;
+        if (::stat(path.c_str(), &statbuf) != 0) return 0;
+        if (delimiter != 0) return statbuf.st_size;
+        try {
+            xlsx::ZipReader reader(path, false);
+            size_t size = 0;
+            for (size_t i = 0; i < reader.size(); ++i) {
+                auto& entry = reader.entry(i);
+                if (entry.name.compare(0, 14, "xl/worksheets/") == 0 ||
+                        entry.name.compare(0, 16, "xl/sharedStrings") == 0) {
+                    size += entry.size;
+                }
+            }
+            return size;
+        } catch (xlsx::Exception&) {
+            return 0;
+        }
+    }
+
+    static inline
+    void release_workbook(const std::string& path, char delimiter) {
+        // no target needs it any more. freed once the last holder drops it.
+        workbook_cache().erase(delimiter != 0 ? delimiter + path : path);
+        trim_workbook_cache();
+    }
+
+    static inline
+    void trim_workbook_cache() {
+        if (workbook_cache_budget() == std::numeric_limits<size_t>::max()) return;
+        workbook_cache().trim(workbook_cache_budget(), [](xlsx::Workbook& book) {
+            return book.memory_size();
+        });
     }
 
     template<class T>
@@ -87,32 +151,119 @@ struct Converter {
         }
 
         handler.begin();
+        auto jobs = yaml_config.arg_config.jobs;
+        if (paths.size() > 1 && jobs > 1) {
+            run_parallel(handler, paths, jobs);
+            handler.end();
+            return;
+        }
         for (int i = 0; i < paths.size(); ++i) {
             auto xls_path = paths[i];
             try {
-                auto book = open_workbook(xls_path, using_cache);
-                auto& sheet = book->sheet_by_name(yaml_config.target_sheet_name);
-                auto column_mapping = map_column(sheet, xls_path);
-                // process data
-                handle(handler, sheet, column_mapping);
+                auto book = open_workbook(xls_path, yaml_config.target_delimiter, using_cache);
+                if (is_streamable(handler) && book->streamable()) {
+                    // not shared with other targets. no need to keep the sheet.
+                    auto cursor = book->row_cursor_by_name(yaml_config.target_sheet_name);
+                    handle(handler, cursor, xls_path);
+                } else {
+                    auto prepared = prepare(book, xls_path, jobs > 1 ? jobs : 0);
+                    // process data
+                    handle(handler, *prepared.sheet, prepared.column_mapping);
+                }
             } catch (utils::exception& exc) {
-                throw EXCEPTION("yaml=", yaml_config.path,
-                                ": xls=", xls_path,
-                                ": sheet=", yaml_config.target_sheet_name,
-                                ": ", exc.what());
+                throw error(xls_path, exc);
             }
         }
         handler.end();
     }
 
+    template<class T>
+    void run_parallel(T& handler, std::vector<std::string>& paths, int jobs) {
+        // glob-merged workbooks are opened and decoded ahead, up to `jobs` at a time.
+        // the handler takes them in path order, so the output does not change.
+        size_t window = parallel_window(paths.size(), jobs);
+        int preload_jobs = std::max<int>(1, jobs / window);
+        std::deque<std::future<Prepared>> pending;
+        size_t next = 0;
+        for (size_t i = 0; i < paths.size(); ++i) {
+            for (; next < paths.size() && next < i + window; ++next) {
+                auto xls_path = paths[next];
+                pending.push_back(std::async(std::launch::async, [this, xls_path, preload_jobs]() {
+                    auto book = open_workbook(xls_path, yaml_config.target_delimiter,
+                                              using_cache);
+                    return prepare(book, xls_path, preload_jobs);
+                }));
+            }
+            auto future = std::move(pending.front());
+            pending.pop_front();
+            try {
+                auto prepared = future.get();
+                handle(handler, *prepared.sheet, prepared.column_mapping);
+            } catch (utils::exception& exc) {
+                throw error(paths[i], exc);
+            }
+        }
+    }
+
+    static inline
+    size_t parallel_window(size_t npaths, int jobs) {
+        // workbooks of one target held decoded at the same time, see run_parallel().
+        return npaths > 1 && jobs > 1 ? std::min<size_t>(jobs, npaths) : 1;
+    }
+
+    struct Prepared {
+        std::shared_ptr<xlsx::Workbook> book;
+        xlsx::Sheet* sheet;
+        std::vector<int> column_mapping;
+    };
+
+    inline
+    Prepared prepare(std::shared_ptr<xlsx::Workbook> book, std::string xls_path,
+                     int preload_jobs) {
+        // preload_jobs: 0 decodes rows on demand.
+        Prepared prepared;
+        prepared.book = book;
+        prepared.sheet = &prepared.book->sheet_by_name(yaml_config.target_sheet_name);
+        prepared.column_mapping = map_column(*prepared.sheet, xls_path);
+        // decode only mapped columns, unless other targets share the sheet.
+        if (!using_cache) prepared.sheet->project(prepared.column_mapping);
+        // a limited run reads a few rows only.
+        if (preload_jobs > 0 && yaml_config.limit == boost::none) {
+            prepared.sheet->preload(preload_jobs);
+        }
+        return prepared;
+    }
+
+    inline
+    utils::exception error(const std::string& xls_path, utils::exception& exc) {
+        return EXCEPTION("yaml=", yaml_config.path,
+                         ": xls=", xls_path,
+                         ": sheet=", yaml_config.target_sheet_name,
+                         ": ", exc.what());
+    }
+
+    template<class T>
+    bool is_streamable(T& handler) {
+        if (using_cache) return false;
+        auto& comment_row = handler.handler_config.comment_row;
+        return comment_row == boost::none || comment_row.value() <= yaml_config.row;
+    }
+
     inline
     std::vector<int> map_column(xlsx::Sheet& sheet, std::string& xls_path) {
+        int rowx = yaml_config.row - 1;
+        return map_column([&](int i) -> xlsx::Cell { return sheet.cell(rowx, i); },
+                          sheet.ncols(), xls_path);
+    }
+
+    template<class F>
+    std::vector<int> map_column(F cell_at, int ncols, std::string& xls_path) {
         std::vector<int> column_mapping;
         for (int k = 0; k < yaml_config.fields.size(); ++k) {
             auto& field = yaml_config.fields[k];
             bool found = false;
-            for (int i = 0; i < sheet.ncols(); ++i) {;
-                auto& cell = sheet.cell(yaml_config.row - 1, i);
+            for (int i = 0; i < ncols; ++i) {;
+                auto cell = cell_at(i);
                 if (cell.as_str() == field.name) {
                     column_mapping.push_back(i);
                     found = true;
@@ -124,8 +275,8 @@ struct Converter {
                     column_mapping.push_back(-1);
                     continue;
                 }
-                for (int i = 0; i < sheet.ncols(); ++i) {
-                    auto& cell = sheet.cell(yaml_config.row-1, i);
+                for (int i = 0; i < ncols; ++i) {
+                    auto cell = cell_at(i);
                     utils::log("cell[", cell.cellname(), "]=", cell.as_str());
                 }
                 throw EXCEPTION(yaml_config.path, ": ", xls_path, ": row=", yaml_config.row,
@@ -140,76 +291,137 @@ struct Converter {
     void handle(T& handler, xlsx::Sheet& sheet, std::vector<int>& column_mapping) {
         if (handler.handler_config.comment_row != boost::none) {
             int row = handler.handler_config.comment_row.value() - 1;
-            handler.begin_comment_row();
-            for (int k = 0; k < column_mapping.size(); ++k) {
-                auto& field = yaml_config.fields[k];
-                if (field.type == YamlConfig::Field::Type::kIsIgnored) continue;
-                auto i = column_mapping[k];
-                if (i == -1) {
-                    handler.field(field, std::string());
-                } else {
-                    auto& cell = sheet.cell(row, i);
-                    handler.field(field, cell.as_str());
-                }
+            handle_comment_row(handler, [&](int i) -> xlsx::Cell { return sheet.cell(row, i); },
+                               column_mapping);
+        }
+        int end = sheet.nrows();
+        if (yaml_config.limit != boost::none) {
+            end = std::min(end, yaml_config.row + yaml_config.limit.value());
+        }
+        // rows without <row> are empty lines.
+        for (int j = sheet.next_row(yaml_config.row); j < end; j = sheet.next_row(j + 1)) {
+            handle_row(handler, [&](int i) -> xlsx::Cell { return sheet.cell(j, i); },
+                       j, column_mapping);
+        }
+    }
+
+    template<class T>
+    void handle(T& handler, xlsx::RowCursor& cursor, std::string& xls_path) {
+        // single pass. rows arrive in ascending order.
+        int header_rowx = yaml_config.row - 1;
+        int comment_rowx = -1;
+        if (handler.handler_config.comment_row != boost::none) {
+            comment_rowx = handler.handler_config.comment_row.value() - 1;
+        }
+        if (yaml_config.limit != boost::none) {
+            // stops inflating the sheet there.
+            cursor.stop_at(yaml_config.row + yaml_config.limit.value());
+        }
+        // rows before the header, except the comment row, are not parsed.
+        xlsx::CellTable comment_cells;
+        bool has_row;
+        if (0 <= comment_rowx && comment_rowx < header_rowx) {
+            has_row = cursor.skip_to(comment_rowx);
+            if (has_row && cursor.row() == comment_rowx) comment_cells = cursor.table();
+            if (has_row && cursor.row() < header_rowx) has_row = cursor.skip_to(header_rowx);
+        } else {
+            has_row = cursor.skip_to(header_rowx);
+        }
+        bool at_header = has_row && cursor.row() == header_rowx;
+        if (at_header && comment_rowx == header_rowx) comment_cells = cursor.table();
+
+        auto header_cell = [&](int i) -> xlsx::Cell {
+            if (at_header) return cursor.cell(i);
+            return xlsx::Cell(header_rowx, i);
+        };
+        auto column_mapping = map_column(header_cell, at_header ? cursor.ncols() : 0, xls_path);
+        cursor.project(column_mapping);
+        if (comment_rowx != -1) {
+            auto comment_cell = [&](int i) -> xlsx::Cell {
+                return comment_cells.cell(0, comment_rowx, i);
+            };
+            handle_comment_row(handler, comment_cell, column_mapping);
+        }
+        if (at_header) has_row = cursor.next();
+        for (; has_row; has_row = cursor.next()) {
+            handle_row(handler, [&](int i) -> xlsx::Cell { return cursor.cell(i); },
+                       cursor.row(), column_mapping);
+        }
+    }
+
+    template<class T, class F>
+    void handle_comment_row(T& handler, F cell_at, std::vector<int>& column_mapping) {
+        handler.begin_comment_row();
+        for (int k = 0; k < column_mapping.size(); ++k) {
+            auto& field = yaml_config.fields[k];
+            if (field.type == YamlConfig::Field::Type::kIsIgnored) continue;
+            auto i = column_mapping[k];
+            if (i == -1) {
+                handler.field(field, std::string());
+            } else {
+                auto cell = cell_at(i);
+                handler.field(field, cell.as_str());
             }
-            handler.end_comment_row();
         }
-        for (int j = yaml_config.row; j < sheet.nrows(); ++j) {
-            bool is_empty_line = true;
-            bool is_ignored = false;
-            for (int k = 0; k < column_mapping.size(); ++k) {
-                using CT = xlsx::Cell::Type;
-                auto& field = yaml_config.fields[k];
-                auto i = column_mapping[k];
-                auto& cell = sheet.cell(j, i);
-                if (i == -1) continue;
-                if (cell.type != CT::kEmpty) {
-                    is_empty_line = false;
-                }
-                if (field.type == YamlConfig::Field::Type::kIsIgnored) {
-                    if (cell.type == CT::kBool) {
-                        is_ignored = cell.as_bool();
-                    }
-                    if (cell.type == CT::kInt || cell.type == CT::kDouble) {
-                        is_ignored = cell.as_int() != 0;
-                    }
-                    if (cell.type == CT::kString) {
-                        is_ignored = truthy(cell.as_str());
-                    }
-                    if (is_ignored) break;
-                }
+        handler.end_comment_row();
+    }
+
+    template<class T, class F>
+    void handle_row(T& handler, F cell_at, int j, std::vector<int>& column_mapping) {
+        bool is_empty_line = true;
+        bool is_ignored = false;
+        for (int k = 0; k < column_mapping.size(); ++k) {
+            using CT = xlsx::Cell::Type;
+            auto& field = yaml_config.fields[k];
+            auto i = column_mapping[k];
+            if (i == -1) continue;
+            auto cell = cell_at(i);
+            if (cell.type != CT::kEmpty) {
+                is_empty_line = false;
             }
-            if (is_empty_line || is_ignored) { continue; }
-
-            handler.begin_row();
-            for (int k = 0; k < column_mapping.size(); ++k) {
-                auto& field = yaml_config.fields[k];
-                if (field.type == YamlConfig::Field::Type::kIsIgnored) continue;
-                auto i = column_mapping[k];
-                if (i == -1) {;
-                    if (!field.using_default) {
-                        throw EXCEPTION("optional field requires default.");
-                    }
-                    handle_cell_default(handler, field);
-                } else {
-                    auto& cell = sheet.cell(j, i);
-                    auto& validator = validators[k];
-                    auto& relation = relations[k];
-                    try {
-                        handle_cell(handler, cell, field, validator, relation);
-                    } catch (std::exception& exc) {
-                        throw EXCEPTION("field=", field.column, ": cell[", cell.cellname(), "]=",
-                                        "{value=", cell.as_str(), ",type=", cell.type_name(), "}: ",
-                                        exc.what());
-                    }
+            if (field.type == YamlConfig::Field::Type::kIsIgnored) {
+                if (cell.type == CT::kBool) {
+                    is_ignored = cell.as_bool();
                 }
+                if (cell.type == CT::kInt || cell.type == CT::kDouble) {
+                    is_ignored = cell.as_int() != 0;
+                }
+                if (cell.type == CT::kString) {
+                    is_ignored = truthy(cell.as_str());
+                }
+                if (is_ignored) break;
             }
-            try {
-                handler.end_row();
-            } catch (std::exception& exc) {
-                throw EXCEPTION("row=", j, ": ", exc.what());
+        }
+        if (is_empty_line || is_ignored) return;
+
+        handler.begin_row();
+        for (int k = 0; k < column_mapping.size(); ++k) {
+            auto& field = yaml_config.fields[k];
+            if (field.type == YamlConfig::Field::Type::kIsIgnored) continue;
+            auto i = column_mapping[k];
+            if (i == -1) {;
+                if (!field.using_default) {
+                    throw EXCEPTION("optional field requires default.");
+                }
+                handle_cell_default(handler, field);
+            } else {
+                auto cell = cell_at(i);
+                auto& validator = validators[k];
+                auto& relation = relations[k];
+                try {
+                    handle_cell(handler, cell, field, validator, relation);
+                } catch (std::exception& exc) {
+                    throw EXCEPTION("field=", field.column, ": cell[", cell.cellname(), "]=",
+                                    "{value=", cell.as_str(), ",type=", cell.type_name(), "}: ",
+                                    exc.what());
+                }
             }
         }
+        try {
+            handler.end_row();
+        } catch (std::exception& exc) {
+            throw EXCEPTION("row=", j, ": ", exc.what());
+        }
     }
 
     template<class T>
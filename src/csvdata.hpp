@@ -0,0 +1,145 @@
+// Copyright (c) 2016 peposso All Rights Reserved.
+// Released under the MIT license
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <string>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace xlsx {
+namespace csvdata {
+
+// lexical kernels for csv and tsv (RFC 4180) sources (see Sheet::decode_csv).
+// records end at '\n'. a quoted field may have delimiters, newlines and "" in it.
+
+inline const char* find_stop(const char* p, const char* end, char delim, int& ndelims) {
+    // first '\n' or '"' from p. delimiters before it are counted, 16 bytes at a time.
+#ifdef __SSE2__
+    auto vn = _mm_set1_epi8('\n');
+    auto vq = _mm_set1_epi8('"');
+    auto vd = _mm_set1_epi8(delim);
+    for (; p + 16 <= end; p += 16) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int stop = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, vn), _mm_cmpeq_epi8(x, vq)));
+        int d = _mm_movemask_epi8(_mm_cmpeq_epi8(x, vd));
+        if (stop != 0) {
+            int k = __builtin_ctz(stop);
+            ndelims += __builtin_popcount(d & ((1 << k) - 1));
+            return p + k;
+        }
+        ndelims += __builtin_popcount(d);
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == '\n' || *p == '"') return p;
+        if (*p == delim) ndelims++;
+    }
+    return end;
+}
+
+inline const char* scan_record(const char* p, const char* end, char delim, int& nfields) {
+    // p: start of a record. returns its end, at '\n' or end.
+    // nfields: delimiters outside quotes + 1.
+    int ndelims = 0;
+    auto begin = p;
+    const char* closed = nullptr;
+    for (;;) {
+        p = find_stop(p, end, delim, ndelims);
+        if (p == end || *p == '\n') break;
+        // '"' opens a quote at the start of a field only.
+        // "" in a quoted field is a quote closed and opened again.
+        if (p != begin && p[-1] != delim && p != closed) {
+            ++p;
+            continue;
+        }
+        auto q = static_cast<const char*>(memchr(p + 1, '"', end - p - 1));
+        if (q == nullptr) {
+            p = end;
+            break;
+        }
+        p = closed = q + 1;
+    }
+    nfields = ndelims + 1;
+    return p;
+}
+
+inline bool is_blank(const char* p, const char* end) {
+    // an empty line, maybe with CR.
+    return p == end || (p + 1 == end && *p == '\r');
+}
+
+inline const char* next_field(const char* p, const char* end, char delim,
+                              std::string& buffer, const char*& v, size_t& v_size) {
+    // p: start of a field in [p, end) of a record. v: the field, unquoted.
+    // returns the start of the next field, or nullptr after the last one.
+    if (p < end && *p == '"') {
+        // quoted. unescaped into buffer. text after the closing quote is kept as is.
+        buffer.clear();
+        ++p;
+        for (;;) {
+            auto q = static_cast<const char*>(memchr(p, '"', end - p));
+            if (q == nullptr) {
+                buffer.append(p, end);
+                p = end;
+                break;
+            }
+            buffer.append(p, q);
+            p = q + 1;
+            if (p < end && *p == '"') {
+                buffer.push_back('"');
+                ++p;
+                continue;
+            }
+            break;
+        }
+        const char* d = nullptr;
+        if (p < end) d = static_cast<const char*>(memchr(p, delim, static_cast<size_t>(end - p)));
+        auto field_end = d != nullptr ? d : end;
+        if (d == nullptr && field_end > p && field_end[-1] == '\r') --field_end;
+        buffer.append(p, field_end);
+        v = buffer.data();
+        v_size = buffer.size();
+        return d != nullptr ? d + 1 : nullptr;
+    }
+    v = p;
+    if (p >= end) {
+        // an empty last field.
+        v_size = 0;
+        return nullptr;
+    }
+    auto d = static_cast<const char*>(memchr(p, delim, static_cast<size_t>(end - p)));
+    if (d != nullptr) {
+        v_size = d - p;
+        return d + 1;
+    }
+    // the last field. CRLF.
+    v_size = end - p;
+    if (v_size > 0 && p[v_size - 1] == '\r') v_size--;
+    return nullptr;
+}
+
+inline bool is_number(const char* v, size_t size) {
+    // what a spreadsheet would read as a number: [+-]digits[.digits][E[+-]digits].
+    size_t i = 0;
+    if (i < size && (v[i] == '+' || v[i] == '-')) ++i;
+    size_t digits = 0;
+    for (; i < size && '0' <= v[i] && v[i] <= '9'; ++i) digits++;
+    if (i < size && v[i] == '.') {
+        for (++i; i < size && '0' <= v[i] && v[i] <= '9'; ++i) digits++;
+    }
+    if (digits == 0) return false;
+    if (i < size && (v[i] == 'E' || v[i] == 'e')) {
+        ++i;
+        if (i < size && (v[i] == '+' || v[i] == '-')) ++i;
+        size_t exp_digits = 0;
+        for (; i < size && '0' <= v[i] && v[i] <= '9'; ++i) exp_digits++;
+        if (exp_digits == 0) return false;
+    }
+    return i == size;
+}
+
+}  // namespace csvdata
+}  // namespace xlsx
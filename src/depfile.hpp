@@ -0,0 +1,63 @@
+// Copyright (c) 2016 peposso All Rights Reserved.
+// Released under the MIT license
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "utils.hpp"
+#include "yaml_config.hpp"
+
+namespace xlsxconverter {
+
+struct Depfile {
+    // make-compatible dependency file (<output>.d) of a handler output, for --depfile.
+    //   <output>: <yaml> <workbooks...> <relation yamls> <their workbooks...> <template source>
+
+    static inline
+    std::vector<std::string> dependencies(YamlConfig& yaml_config) {
+        std::vector<std::string> paths;
+        std::vector<YamlConfig> configs = {yaml_config};
+        for (auto& rel : yaml_config.relations()) {
+            configs.emplace_back(rel.from, yaml_config.arg_config);
+        }
+        for (auto& config : configs) {
+            auto yaml_path = config.arg_config.search_yaml_path(config.path);
+            if (std::find(paths.begin(), paths.end(), yaml_path) == paths.end()) {
+                paths.push_back(yaml_path);
+            }
+            for (auto& xls_path : config.get_xls_paths()) {
+                if (std::find(paths.begin(), paths.end(), xls_path) == paths.end()) {
+                    paths.push_back(xls_path);
+                }
+            }
+        }
+        return paths;
+    }
+
+    static inline
+    std::string escape(const std::string& path) {
+        // as make reads a target or a prerequisite.
+        std::string s;
+        for (auto c : path) {
+            if (c == ' ' || c == '#') s.push_back('\\');
+            if (c == '$') s.push_back('$');
+            s.push_back(c);
+        }
+        return s;
+    }
+
+    static inline
+    void write(YamlConfig::Handler& handler, const std::vector<std::string>& dependencies) {
+        auto output_path = handler.get_output_path();
+        std::string out = escape(output_path) + ":";
+        for (auto& path : dependencies) out += " \\\n  " + escape(path);
+        if (!handler.source.empty() && handler.type == YamlConfig::Handler::Type::kTemplate) {
+            out += " \\\n  " + escape(handler.source);
+        }
+        out += "\n";
+        utils::fs::writefile(output_path + ".d", out);
+    }
+};
+
+}  // namespace xlsxconverter
@@ -0,0 +1,400 @@
+// Copyright (c) 2016 peposso All Rights Reserved.
+// Released under the MIT license
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+
+namespace xlsx {
+namespace inflate {
+
+// one-shot raw deflate (rfc1951) decoder.
+// the whole input and an output buffer of the exact inflated size are given,
+// so there is no streaming state. bits are kept in a 64bit buffer, and
+// huffman codes are decoded by 2-level tables.
+
+enum Result {
+    kOk,
+    kBadData,
+    kShortOutput,  // output buffer is too small.
+    kTruncated,    // input ended before the final block.
+};
+
+namespace detail {
+
+// table entry: [31:16] base, [15:13] kind, [12:8] extra bits, [7:0] code bits.
+enum Kind : uint32_t {
+    kLiteral = 0,
+    kLength = 1,  // also distance.
+    kEndOfBlock = 2,
+    kSubtable = 3,  // base: subtable offset, extra: subtable bits.
+    kInvalid = 4,
+};
+
+inline uint32_t entry(uint32_t base, uint32_t kind, uint32_t extra, uint32_t bits) {
+    return (base << 16) | (kind << 13) | (extra << 8) | bits;
+}
+inline uint32_t entry_base(uint32_t e) { return e >> 16; }
+inline uint32_t entry_kind(uint32_t e) { return (e >> 13) & 7; }
+inline uint32_t entry_extra(uint32_t e) { return (e >> 8) & 31; }
+inline uint32_t entry_bits(uint32_t e) { return e & 0xff; }
+
+static const int kLitLenTableBits = 10;
+static const int kDistTableBits = 8;
+static const int kPreTableBits = 7;
+static const int kMaxCodeBits = 15;
+// primary + (worst case) one subtable per long symbol.
+static const int kLitLenTableSize =
+    (1 << kLitLenTableBits) + 288 * (1 << (kMaxCodeBits - kLitLenTableBits));
+static const int kDistTableSize =
+    (1 << kDistTableBits) + 32 * (1 << (kMaxCodeBits - kDistTableBits));
+
+static const uint16_t length_base[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t length_extra[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const uint16_t dist_base[] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const uint8_t dist_extra[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+static const uint8_t precode_order[] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+enum Alphabet { kLitLenAlphabet, kDistAlphabet, kPreAlphabet };
+
+inline uint32_t symbol_entry(Alphabet alphabet, int sym, uint32_t bits) {
+    switch (alphabet) {
+        case kLitLenAlphabet:
+            if (sym < 256) return entry(sym, kLiteral, 0, bits);
+            if (sym == 256) return entry(0, kEndOfBlock, 0, bits);
+            if (sym < 286) {
+                return entry(length_base[sym - 257], kLength, length_extra[sym - 257], bits);
+            }
+            return entry(0, kInvalid, 0, bits);
+        case kDistAlphabet:
+            if (sym < 30) return entry(dist_base[sym], kLength, dist_extra[sym], bits);
+            return entry(0, kInvalid, 0, bits);
+        default:
+            return entry(sym, kLiteral, 0, bits);
+    }
+}
+
+inline uint32_t reverse_bits(uint32_t code, int n) {
+    uint32_t r = 0;
+    for (int i = 0; i < n; ++i) {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+// builds a decode table from code lengths. false: over-subscribed,
+// or incomplete (allowed for a single 1-bit code, as zlib does).
+inline bool build_table(uint32_t* table, int table_bits, const uint8_t* lens, int n,
+                        Alphabet alphabet) {
+    int count[kMaxCodeBits + 1] = {0};
+    for (int i = 0; i < n; ++i) count[lens[i]]++;
+    count[0] = 0;
+    int max_len = 0;
+    int left = 1;
+    for (int len = 1; len <= kMaxCodeBits; ++len) {
+        left = (left << 1) - count[len];
+        if (left < 0) return false;
+        if (count[len] > 0) max_len = len;
+    }
+    if (left > 0 && (alphabet == kPreAlphabet || max_len > 1)) return false;
+
+    uint32_t next_code[kMaxCodeBits + 1];
+    uint32_t code = 0;
+    for (int len = 1; len <= kMaxCodeBits; ++len) {
+        code = (code + count[len - 1]) << 1;
+        next_code[len] = code;
+    }
+
+    uint32_t size = 1u << table_bits;
+    uint32_t invalid = entry(0, kInvalid, 0, 1);
+    for (uint32_t i = 0; i < size; ++i) table[i] = invalid;
+    int sub_bits = max_len > table_bits ? max_len - table_bits : 0;
+    uint32_t sub_size = 1u << sub_bits;
+    uint32_t next_sub = size;
+    uint32_t mask = size - 1;
+
+    for (int sym = 0; sym < n; ++sym) {
+        int len = lens[sym];
+        if (len == 0) continue;
+        uint32_t rev = reverse_bits(next_code[len]++, len);
+        if (len <= table_bits) {
+            auto e = symbol_entry(alphabet, sym, len);
+            for (uint32_t i = rev; i < size; i += 1u << len) table[i] = e;
+            continue;
+        }
+        uint32_t prefix = rev & mask;
+        if (entry_kind(table[prefix]) != kSubtable) {
+            table[prefix] = entry(next_sub, kSubtable, sub_bits, table_bits);
+            for (uint32_t i = 0; i < sub_size; ++i) table[next_sub + i] = invalid;
+            next_sub += sub_size;
+        }
+        uint32_t sub = entry_base(table[prefix]);
+        int sub_len = len - table_bits;
+        auto e = symbol_entry(alphabet, sym, sub_len);
+        for (uint32_t i = rev >> table_bits; i < sub_size; i += 1u << sub_len) table[sub + i] = e;
+    }
+    return true;
+}
+
+struct BitReader {
+    const uint8_t* in;
+    const uint8_t* in_end;
+    uint64_t bitbuf = 0;
+    int bitsleft = 0;
+    int overrun = 0;  // zero bytes fed past the end.
+
+    BitReader(const uint8_t* in_, const uint8_t* in_end_) : in(in_), in_end(in_end_) {}
+
+    // at least 56 bits available after this.
+    inline void refill() {
+        if (in_end - in >= 8) {
+            uint64_t v;
+            memcpy(&v, in, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            v = __builtin_bswap64(v);
+#endif
+            bitbuf |= v << bitsleft;
+            in += (63 - bitsleft) >> 3;
+            bitsleft |= 56;
+            return;
+        }
+        while (bitsleft <= 56) {
+            if (in < in_end) {
+                bitbuf |= static_cast<uint64_t>(*in++) << bitsleft;
+            } else {
+                overrun++;
+            }
+            bitsleft += 8;
+        }
+    }
+
+    inline uint32_t peek(int n) { return bitbuf & ((uint64_t(1) << n) - 1); }
+    inline void consume(int n) { bitbuf >>= n; bitsleft -= n; }
+    inline uint32_t bits(int n) {
+        uint32_t v = peek(n);
+        consume(n);
+        return v;
+    }
+    inline bool truncated() {
+        // consumed bits past the real input.
+        return overrun * 8 > bitsleft;
+    }
+};
+
+inline uint32_t decode(BitReader& br, const uint32_t* table, int table_bits) {
+    uint32_t e = table[br.peek(table_bits)];
+    if (entry_kind(e) == kSubtable) {
+        br.consume(table_bits);
+        e = table[entry_base(e) + br.peek(entry_extra(e))];
+    }
+    br.consume(entry_bits(e));
+    return e;
+}
+
+struct FixedTables {
+    // tables of the fixed huffman codes (btype=1). built once.
+    uint32_t litlen[1 << kLitLenTableBits];
+    uint32_t dist[1 << kDistTableBits];
+
+    FixedTables() {
+        uint8_t lens[288];
+        int i = 0;
+        for (; i < 144; ++i) lens[i] = 8;
+        for (; i < 256; ++i) lens[i] = 9;
+        for (; i < 280; ++i) lens[i] = 7;
+        for (; i < 288; ++i) lens[i] = 8;
+        build_table(litlen, kLitLenTableBits, lens, 288, kLitLenAlphabet);
+        for (i = 0; i < 32; ++i) lens[i] = 5;
+        build_table(dist, kDistTableBits, lens, 32, kDistAlphabet);
+    }
+
+    static const FixedTables& get() {
+        static const FixedTables tables;
+        return tables;
+    }
+};
+
+inline Result read_dynamic(BitReader& br, uint32_t* litlen, uint32_t* dist) {
+    br.refill();
+    int nlitlen = br.bits(5) + 257;
+    int ndist = br.bits(5) + 1;
+    int nprecode = br.bits(4) + 4;
+    if (nlitlen > 286 || ndist > 30) return kBadData;
+    uint8_t prelens[19] = {0};
+    for (int i = 0; i < nprecode; ++i) {
+        if (br.bitsleft < 3) br.refill();
+        prelens[precode_order[i]] = br.bits(3);
+    }
+    uint32_t pretable[1 << kPreTableBits];
+    if (!build_table(pretable, kPreTableBits, prelens, 19, kPreAlphabet)) return kBadData;
+
+    uint8_t lens[286 + 30];
+    int n = nlitlen + ndist;
+    for (int i = 0; i < n;) {
+        if (br.bitsleft < 16) br.refill();
+        auto e = decode(br, pretable, kPreTableBits);
+        if (entry_kind(e) == kInvalid) return kBadData;
+        int sym = entry_base(e);
+        if (sym < 16) {
+            lens[i++] = sym;
+            continue;
+        }
+        int rep;
+        uint8_t value = 0;
+        if (sym == 16) {
+            if (i == 0) return kBadData;
+            value = lens[i - 1];
+            rep = 3 + br.bits(2);
+        } else if (sym == 17) {
+            rep = 3 + br.bits(3);
+        } else {
+            rep = 11 + br.bits(7);
+        }
+        if (i + rep > n) return kBadData;
+        while (rep-- > 0) lens[i++] = value;
+    }
+    if (br.truncated()) return kTruncated;
+    if (lens[256] == 0) return kBadData;
+    if (!build_table(litlen, kLitLenTableBits, lens, nlitlen, kLitLenAlphabet)) return kBadData;
+    if (!build_table(dist, kDistTableBits, lens + nlitlen, ndist, kDistAlphabet)) return kBadData;
+    return kOk;
+}
+
+inline void copy_match(uint8_t* out, size_t dist, size_t length, uint8_t* out_end) {
+    const uint8_t* src = out - dist;
+    if (dist == 1) {
+        memset(out, src[0], length);
+        return;
+    }
+    if (dist >= 8 && out_end - out >= static_cast<ptrdiff_t>(length + 8)) {
+        // 8 byte steps. may write up to 7 bytes beyond length, inside out_end.
+        auto end = out + length;
+        do {
+            memcpy(out, src, 8);
+            out += 8;
+            src += 8;
+        } while (out < end);
+        return;
+    }
+    while (length-- > 0) *out++ = *src++;
+}
+
+}  // namespace detail
+
+// inflates raw deflate data in [in, in + in_size) into out.
+// *out_size: inflated bytes.
+inline Result inflate(const void* in, size_t in_size, void* out, size_t out_capacity,
+                      size_t* out_size) {
+    using namespace detail;
+    BitReader br(static_cast<const uint8_t*>(in), static_cast<const uint8_t*>(in) + in_size);
+    auto out_begin = static_cast<uint8_t*>(out);
+    auto out_end = out_begin + out_capacity;
+    auto op = out_begin;
+
+    uint32_t dynamic_litlen[kLitLenTableSize];
+    uint32_t dynamic_dist[kDistTableSize];
+    const uint32_t* litlen;
+    const uint32_t* dist;
+    const int litlen_mask = (1 << kLitLenTableBits) - 1;
+
+    bool final_block = false;
+    while (!final_block) {
+        br.refill();
+        final_block = br.bits(1) != 0;
+        int type = br.bits(2);
+        if (type == 0) {
+            // stored. skip to the byte boundary, and read LEN and NLEN.
+            br.consume(br.bitsleft & 7);
+            uint32_t len = br.bits(16);
+            uint32_t nlen = br.bits(16);
+            if (br.truncated()) return kTruncated;
+            if ((len ^ 0xffff) != nlen) return kBadData;
+            // give back the whole bytes left in the bit buffer.
+            br.in -= (br.bitsleft >> 3) - br.overrun;
+            br.bitbuf = 0;
+            br.bitsleft = 0;
+            br.overrun = 0;
+            if (static_cast<size_t>(br.in_end - br.in) < len) return kTruncated;
+            if (static_cast<size_t>(out_end - op) < len) return kShortOutput;
+            memcpy(op, br.in, len);
+            op += len;
+            br.in += len;
+            continue;
+        }
+        if (type == 1) {
+            litlen = FixedTables::get().litlen;
+            dist = FixedTables::get().dist;
+        } else if (type == 2) {
+            auto result = read_dynamic(br, dynamic_litlen, dynamic_dist);
+            if (result != kOk) return result;
+            litlen = dynamic_litlen;
+            dist = dynamic_dist;
+        } else {
+            return kBadData;
+        }
+
+        for (;;) {
+            br.refill();
+            uint32_t e = litlen[br.bitbuf & litlen_mask];
+            if (entry_kind(e) == kLiteral) {
+                // literals are the most frequent. take up to 2 in a row.
+                br.consume(entry_bits(e));
+                if (op == out_end) return kShortOutput;
+                *op++ = entry_base(e);
+                e = litlen[br.bitbuf & litlen_mask];
+                if (entry_kind(e) == kLiteral) {
+                    br.consume(entry_bits(e));
+                    if (op == out_end) return kShortOutput;
+                    *op++ = entry_base(e);
+                    continue;
+                }
+                br.refill();
+            }
+            if (entry_kind(e) == kSubtable) {
+                br.consume(kLitLenTableBits);
+                e = litlen[entry_base(e) + br.peek(entry_extra(e))];
+            }
+            br.consume(entry_bits(e));
+            auto kind = entry_kind(e);
+            if (kind == kLiteral) {
+                if (op == out_end) return kShortOutput;
+                *op++ = entry_base(e);
+                continue;
+            }
+            if (kind == kEndOfBlock) break;
+            if (kind != kLength) return kBadData;
+            size_t length = entry_base(e) + br.bits(entry_extra(e));
+
+            // 56 - (15 + 5) bits left at least. distance needs up to 15 + 13.
+            auto d = decode(br, dist, kDistTableBits);
+            if (entry_kind(d) != kLength) return kBadData;
+            size_t distance = entry_base(d) + br.bits(entry_extra(d));
+            if (br.truncated()) return kTruncated;
+            if (distance > static_cast<size_t>(op - out_begin)) return kBadData;
+            if (length > static_cast<size_t>(out_end - op)) return kShortOutput;
+            copy_match(op, distance, length, out_end);
+            op += length;
+        }
+        if (br.truncated()) return kTruncated;
+    }
+    *out_size = op - out_begin;
+    return kOk;
+}
+
+}  // namespace inflate
+}  // namespace xlsx
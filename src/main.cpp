@@ -2,6 +2,7 @@
 // Released under the MIT license
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <utility>
 #include <functional>
 #include <thread>
@@ -11,6 +12,8 @@
 #include "yaml_config.hpp"
 #include "handlers.hpp"
 #include "converter.hpp"
+#include "manifest.hpp"
+#include "depfile.hpp"
 
 #define EXCEPTION XLSXCONVERTER_UTILS_EXCEPTION
 
@@ -19,6 +22,8 @@ namespace {
 using ArgConfig = xlsxconverter::ArgConfig;
 using YamlConfig = xlsxconverter::YamlConfig;
 using Converter = xlsxconverter::Converter;
+using Manifest = xlsxconverter::Manifest;
+using Depfile = xlsxconverter::Depfile;
 namespace utils = xlsxconverter::utils;
 namespace handlers = xlsxconverter::handlers;
 
@@ -36,11 +41,14 @@ struct MainTask {
     using lock_guard = std::lock_guard<std::mutex>;
     utils::mutex_list<std::string> targets;
     utils::mutex_list<YamlConfig> yaml_configs;
+    utils::mutex_list<YamlConfig> deferred_yaml_configs;  // over --max_memory when taken.
     utils::mutex_list<YamlConfig::Field::Relation> relations;
     utils::mutex_list<RelationYaml> relation_yamls;
     utils::mutex_map<std::string, int> target_xls_counts;
 
     ArgConfig& arg_config;
+    std::unique_ptr<Manifest> manifest;  // --incremental
+    std::unique_ptr<utils::memory_budget> memory_budget;  // --max_memory
     bool canceled;
     std::mutex phase1_done;
     std::mutex phase2_done;
@@ -65,6 +73,13 @@ struct MainTask {
                 targets.push_back(target);
             }
         }
+        if (arg_config.max_memory > 0) {
+            memory_budget = std::unique_ptr<utils::memory_budget>(
+                new utils::memory_budget(static_cast<size_t>(arg_config.max_memory) << 20));
+        }
+        if (arg_config.incremental) {
+            manifest = std::unique_ptr<Manifest>(new Manifest(arg_config));
+        }
         phase1_done.lock();
         phase2_done.lock();
         phase3_done.lock();
@@ -101,6 +116,53 @@ struct MainTask {
         template<class T> bool operator()(T& t) { return t.id == id; }
     };
 
+    struct Admission {
+        // estimated bytes of the workbooks a conversion reads, held while it runs.
+        utils::memory_budget* budget = nullptr;
+        utils::memory_budget::Items items;
+        inline ~Admission() {
+            if (budget != nullptr) budget->release(items);
+        }
+    };
+
+    bool admit(YamlConfig& yaml_config, bool wait, Admission& admission) {
+        // false: it does not fit in --max_memory now, and wait is false.
+        if (!memory_budget) return true;
+        bool reads = false;
+        for (auto& handler : yaml_config.handlers) {
+            reads = reads || handler.type != YamlConfig::Handler::Type::kNone;
+        }
+        if (!reads) return true;  // no workbook is opened.
+        utils::memory_budget::Items items;
+        auto paths = yaml_config.get_xls_paths();
+        for (auto& path : paths) {
+            auto delimiter = yaml_config.target_delimiter;
+            items.emplace_back(delimiter != 0 ? delimiter + path : path,
+                               Converter::estimate_memory(path, delimiter));
+        }
+        // the largest workbooks the converter can hold decoded at once. any set of them
+        // in flight fits in this.
+        auto window = Converter::parallel_window(paths.size(), arg_config.jobs);
+        using Item = utils::memory_budget::Items::value_type;
+        std::stable_sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+            return a.second > b.second;
+        });
+        if (items.size() > window) items.resize(window);
+        if (!memory_budget->acquire(items, wait)) return false;
+        admission.budget = memory_budget.get();
+        admission.items = std::move(items);
+        return true;
+    }
+
+    void release(YamlConfig& yaml_config) {
+        // target_xls_counts: targets and relations yet to read each shared workbook.
+        // the last one frees it. a workbook not shared is not kept.
+        for (auto& path : yaml_config.get_xls_paths()) {
+            if (target_xls_counts.has(path) && target_xls_counts.add(path, -1) > 0) continue;
+            Converter::release_workbook(path, yaml_config.target_delimiter);
+        }
+    }
+
     void phase1() {
         while (!canceled) {
             auto target_opt = targets.move_front();
@@ -109,6 +171,12 @@ struct MainTask {
 
             try {
                 auto yaml_config = YamlConfig(target, arg_config);
+                if (manifest && manifest->check(yaml_config)) {
+                    if (!arg_config.quiet) {
+                        utils::log("up-to-date: ", yaml_config.path);
+                    }
+                    continue;
+                }
                 for (auto rel : yaml_config.relations()) {
                     // check file existance.
                     arg_config.search_yaml_path(rel.from);
@@ -127,6 +195,7 @@ struct MainTask {
         }
         --phase1_running;
         if (phase1_running.load() == 0) {
+            if (manifest) manifest->release();
             if (relations.empty()) {
                 target_xls_counts.erase([](std::string, int c){return c == 1;});
                 phase3_done.unlock();
@@ -167,12 +236,17 @@ struct MainTask {
             auto yaml_config = std::move(rel_yaml->yaml_config);
 
             if (handlers::RelationMap::has_cache(rel)) {
+                release(yaml_config);
                 continue;
             }
+            Admission admission;
+            // waits until it fits, so it is always admitted. the result is not needed.
+            admit(yaml_config, true, admission);
             auto relmap = handlers::RelationMap(rel, yaml_config);
             auto using_shared = target_xls_counts.has(yaml_config.get_xls_paths()[0]);
             Converter(yaml_config, using_shared, true).run(relmap);
             handlers::RelationMap::store_cache(std::move(relmap));
+            release(yaml_config);
         }
         --phase3_running;
         if (phase3_running.load() == 0) {
@@ -181,13 +255,27 @@ struct MainTask {
     }
     void phase4() {
         while (!canceled) {
+            // a target over --max_memory is put aside, and smaller ones are taken first.
+            // put aside ones are taken last, waiting until they fit.
+            bool wait = false;
             auto yaml_config_opt = yaml_configs.move_front();
-            if (yaml_config_opt == boost::none) break;
+            if (yaml_config_opt == boost::none) {
+                yaml_config_opt = deferred_yaml_configs.move_front();
+                if (yaml_config_opt == boost::none) break;
+                wait = true;
+            }
             auto& yaml_config = yaml_config_opt.value();
+            Admission admission;
+            if (!admit(yaml_config, wait, admission)) {
+                deferred_yaml_configs.push_back(std::move(yaml_config));
+                continue;
+            }
 
             using HT = YamlConfig::Handler::Type;
             auto using_shared = target_xls_counts.has(yaml_config.get_xls_paths()[0]);
             auto converter = Converter(yaml_config, using_shared);
+            std::vector<std::string> dependencies;
+            if (arg_config.depfile) dependencies = Depfile::dependencies(yaml_config);
             for (auto& yaml_handler : yaml_config.handlers) {
                 if (yaml_handler.type == YamlConfig::Handler::Type::kNone) {
                     if (!arg_config.quiet) {
@@ -203,6 +291,7 @@ struct MainTask {
                             converter.run(handler); \
                             if (canceled) break; \
                             handler.save(arg_config); \
+                            if (arg_config.depfile) Depfile::write(yaml_handler, dependencies); \
                             break; \
                         }
                     CASE(HT::kJson, handlers::JsonHandler);
@@ -219,6 +308,8 @@ struct MainTask {
                     }
                 }
             }
+            if (manifest && !canceled) manifest->record(yaml_config);
+            release(yaml_config);
         }
     }
 };
@@ -245,6 +336,19 @@ int main(int argc, char** argv) {
     if (arg_config->verbose) {
         xlsx::verbose() = true;
     }
+    if (arg_config->max_memory > 0 && !arg_config->quiet) {
+        utils::log("max_memory: ", arg_config->max_memory, "MB");
+    }
+    if (arg_config->cache_budget >= 0) {
+        Converter::workbook_cache_budget() = static_cast<size_t>(arg_config->cache_budget) << 20;
+    } else {
+        Converter::workbook_cache_budget() = std::numeric_limits<size_t>::max();
+    }
+    if (!arg_config->cache_dir.empty()) {
+        // decoded sheets are kept across runs.
+        utils::fs::mkdirp(arg_config->cache_dir);
+        xlsx::snapshot_dir() = arg_config->cache_dir;
+    }
 
     int jobs = arg_config->jobs;
     if (!arg_config->quiet) {
@@ -286,6 +390,16 @@ int main(int argc, char** argv) {
         tasks[i].join();
     }
 
+    if (task.manifest) {
+        // targets built before a failure are kept.
+        try {
+            task.manifest->save();
+        } catch (std::exception& exc) {
+            utils::logerr("exception: ", exc.what());
+            return 1;
+        }
+    }
+
     if (task.canceled) {
         return 1;
     }
@@ -0,0 +1,257 @@
+// Copyright (c) 2016 peposso All Rights Reserved.
+// Released under the MIT license
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+#include "utils.hpp"
+#include "xlsx.hpp"
+#include "arg_config.hpp"
+#include "yaml_config.hpp"
+
+#define EXCEPTION XLSXCONVERTER_UTILS_EXCEPTION
+
+namespace xlsxconverter {
+
+struct Manifest {
+    // what each target read and wrote in the last build, for --incremental.
+    // a target is skipped while its inputs and outputs are as recorded.
+    // one record per line: <kind>\t<key fields...>\t<state fields...>
+    //   yaml    <path>                    crc32 (the target and each relation.from)
+    //   file    <path>                    crc32 (csv/tsv targets, template sources)
+    //   sheet   <xls path>\t<sheet name>  entry, crc32s of the sheet, styles and
+    //                                     sharedStrings entries, nstrings, crc32 of strings
+    //   output  <path>                    crc32
+    // sheet crc32s are from the zip central directory. shared strings are read only if
+    // their entry changed: the sheet is unchanged if the strings it could refer to are.
+    using Record = std::pair<std::string, std::string>;  // key, state
+    using Records = std::vector<Record>;
+
+    std::string path;
+    std::string options;  // what changes every output.
+    std::unordered_map<std::string, Records> targets;  // by yaml path. the last build.
+    std::unordered_map<std::string, Records> pending;  // inputs, before conversion.
+    std::mutex mutex;
+    utils::shared_cache<std::string, xlsx::Workbook> books;
+
+    inline
+    explicit Manifest(const ArgConfig& arg_config)
+            : path(utils::fs::joinpath(arg_config.output_base_path, ".xlsxconverter_manifest")),
+              options(utils::sscat("options\t", BUILD_REVISION, "\t", arg_config.tz_seconds)) {
+        if (!utils::fs::exists(path)) return;
+        std::ifstream in(path.c_str(), std::ios::binary);
+        std::string line;
+        if (!std::getline(in, line) || line != options) return;
+        Records* records = nullptr;
+        while (std::getline(in, line)) {
+            auto fields = utils::split(line, '\t');
+            if (fields[0] == "target" && fields.size() == 2) {
+                records = &targets[fields[1]];
+                continue;
+            }
+            if (records == nullptr) continue;
+            // the key is the kind and 1 or 2 fields.
+            size_t nkeys = fields[0] == "sheet" ? 3 : 2;
+            auto end = line.begin();
+            for (size_t i = 0; i < nkeys && end != line.end(); ++i) {
+                end = std::find(end, line.end(), '\t');
+                if (end != line.end()) ++end;
+            }
+            if (end == line.end()) continue;
+            records->emplace_back(std::string(line.begin(), end - 1), std::string(end, line.end()));
+        }
+    }
+
+    inline
+    void save() {
+        // written aside, and renamed.
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::string> names;
+        for (auto& kv : targets) names.push_back(kv.first);
+        std::sort(names.begin(), names.end());
+        std::string out = options + "\n";
+        for (auto& name : names) {
+            out += "target\t" + name + "\n";
+            for (auto& record : targets[name]) out += record.first + "\t" + record.second + "\n";
+        }
+        auto tmp_path = path + ".tmp";
+        utils::fs::writefile(tmp_path, out);
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            throw EXCEPTION(path, ": cant write.");
+        }
+    }
+
+    inline
+    bool check(YamlConfig& yaml_config) {
+        // true: up to date. otherwise the current inputs are kept for record().
+        Records records;
+        for (auto& key : input_keys(yaml_config)) records.emplace_back(key, "");
+        for (auto& key : output_keys(yaml_config)) records.emplace_back(key, "");
+        Records last;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = targets.find(yaml_config.path);
+            if (it != targets.end()) {
+                last.swap(it->second);
+                targets.erase(it);
+            }
+        }
+        std::unordered_map<std::string, std::string> last_states(last.begin(), last.end());
+        bool same = last.size() == records.size();
+        for (auto& record : records) {
+            // outputs are not needed, once an input has changed.
+            if (!same && record.first.compare(0, 7, "output\t") == 0) continue;
+            auto it = last_states.find(record.first);
+            bool found = it != last_states.end();
+            same = state(record.first, found ? it->second : "", record.second) && found && same;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (same) {
+            targets[yaml_config.path].swap(records);
+            return true;
+        }
+        records.erase(std::remove_if(records.begin(), records.end(), [](Record& r) {
+            return r.first.compare(0, 7, "output\t") == 0;
+        }), records.end());
+        pending[yaml_config.path].swap(records);
+        return false;
+    }
+
+    inline
+    void record(YamlConfig& yaml_config) {
+        // the outputs are written. inputs are as they were before the conversion.
+        Records records;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            records.swap(pending[yaml_config.path]);
+            pending.erase(yaml_config.path);
+        }
+        for (auto& key : output_keys(yaml_config)) {
+            std::string s;
+            state(key, "", s);
+            records.emplace_back(key, s);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        targets[yaml_config.path].swap(records);
+    }
+
+    inline
+    void release() {
+        // workbooks are only needed while targets are checked.
+        books.clear();
+    }
+
+    inline
+    std::vector<std::string> input_keys(YamlConfig& yaml_config) {
+        std::vector<std::string> keys;
+        std::vector<YamlConfig> configs = {yaml_config};
+        for (auto& rel : yaml_config.relations()) {
+            configs.emplace_back(rel.from, yaml_config.arg_config);
+        }
+        for (auto& config : configs) {
+            keys.push_back("yaml\t" + config.arg_config.search_yaml_path(config.path));
+            for (auto& xls_path : config.get_xls_paths()) {
+                if (config.target_delimiter != 0) {
+                    keys.push_back("file\t" + xls_path);
+                } else {
+                    keys.push_back("sheet\t" + xls_path + "\t" + config.target_sheet_name);
+                }
+            }
+        }
+        for (auto& handler : yaml_config.handlers) {
+            if (handler.type != YamlConfig::Handler::Type::kTemplate) continue;
+            keys.push_back("file\t" + handler.source);
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+    static inline
+    std::vector<std::string> output_keys(YamlConfig& yaml_config) {
+        std::vector<std::string> keys;
+        for (auto& handler : yaml_config.handlers) {
+            if (handler.type == YamlConfig::Handler::Type::kNone) continue;
+            keys.push_back("output\t" + handler.get_output_path());
+        }
+        return keys;
+    }
+
+    static inline
+    uint32_t crc32(const char* p, size_t size, uLong crc = ::crc32(0L, Z_NULL, 0)) {
+        for (size_t n; size > 0; p += n, size -= n) {
+            n = std::min<size_t>(size, 1 << 30);
+            crc = ::crc32(crc, reinterpret_cast<const Bytef*>(p), n);
+        }
+        return crc;
+    }
+
+    inline
+    bool state(const std::string& key, const std::string& last, std::string& current) {
+        // current: the state of an input or output now. "" if missing.
+        // true: it is the same as last.
+        auto fields = utils::split(key, '\t');
+        current.clear();
+        if (fields[0] == "sheet") {
+            return sheet_state(fields[1], fields.size() > 2 ? fields[2] : "", last, current);
+        }
+        try {
+            if (!utils::fs::exists(fields[1])) return false;
+            xlsx::MappedFile file(fields[1]);
+            current = std::to_string(crc32(file.data, file.size));
+        } catch (xlsx::Exception&) {
+            return false;
+        }
+        return !current.empty() && current == last;
+    }
+
+    inline
+    bool sheet_state(const std::string& xls_path, const std::string& sheet_name,
+                     const std::string& last, std::string& current) {
+        std::shared_ptr<xlsx::Workbook> book;
+        try {
+            if (!utils::fs::exists(xls_path)) return false;
+            book = books.get_or_emplace(xls_path, xls_path);
+        } catch (xlsx::Exception&) {
+            return false;
+        }
+        auto rid = book->sheet_rid_by_name.find(sheet_name);
+        if (rid == book->sheet_rid_by_name.end()) return false;
+        std::string ext = book->binary ? ".bin" : ".xml";
+        auto& entry = book->rels[rid->second];
+        auto crc = [&](const std::string& name) {
+            auto it = book->entry_indexes.find(name);
+            return it == book->entry_indexes.end() ? 0 : book->archive->entry(it->second).crc32;
+        };
+        auto prefix = utils::sscat(entry, "\t", crc(entry), "\t", crc("xl/styles" + ext), "\t");
+        auto strings_crc = std::to_string(crc("xl/sharedStrings" + ext));
+        auto fields = utils::split(last, '\t');
+        bool same_sheet = fields.size() == 6 &&
+                          last.compare(0, prefix.size(), prefix) == 0;
+        if (same_sheet && fields[3] == strings_crc) {
+            // sharedStrings is not read.
+            current = last;
+            return true;
+        }
+        auto& strings = *book->shared_string;
+        size_t nstrings = strings.size();
+        if (same_sheet) {
+            // the sheet refers to strings before the last nstrings only.
+            size_t last_nstrings = std::stoull(fields[4]);
+            same_sheet = last_nstrings <= nstrings &&
+                         std::to_string(strings.crc32(last_nstrings)) == fields[5];
+        }
+        current = utils::sscat(prefix, strings_crc, "\t", nstrings, "\t",
+                               strings.crc32(nstrings));
+        return same_sheet;
+    }
+};
+
+}  // namespace xlsxconverter
+#undef EXCEPTION
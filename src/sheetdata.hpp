@@ -0,0 +1,136 @@
+// Copyright (c) 2016 peposso All Rights Reserved.
+// Released under the MIT license
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace xlsx {
+namespace sheetdata {
+
+// lexical kernels for worksheet xml (see Sheet::scan_row).
+// they work on [p, end) of the raw entry without copying, and give up
+// (return false or end) on anything the fast path does not handle.
+
+inline const char* find(const char* p, const char* end, char c) {
+    // memchr is vectorized by libc.
+    auto r = static_cast<const char*>(memchr(p, c, end - p));
+    return r != nullptr ? r : end;
+}
+
+inline const char* find_any(const char* p, const char* end, char a, char b) {
+    // first a or b, 16 bytes at a time.
+#ifdef __SSE2__
+    auto va = _mm_set1_epi8(a);
+    auto vb = _mm_set1_epi8(b);
+    for (; p + 16 <= end; p += 16) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb)));
+        if (m != 0) return p + __builtin_ctz(m);
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == a || *p == b) return p;
+    }
+    return end;
+}
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool is_tag(const char* p, const char* end, const char* name, size_t n) {
+    // p: after '<'. name, and a delimiter after it.
+    if (end - p <= static_cast<ptrdiff_t>(n)) return false;
+    if (memcmp(p, name, n) != 0) return false;
+    char c = p[n];
+    return c == '>' || c == '/' || is_space(c);
+}
+
+struct Attr {
+    const char* name;
+    size_t name_size;
+    const char* value;
+    size_t value_size;
+};
+
+inline int next_attr(const char*& p, const char* end, Attr& attr, bool& empty) {
+    // reads an attribute of a start tag. p: after the tag name.
+    //   1: attr is read.
+    //   0: end of the tag. p is after '>'. empty: it was '/>'.
+    //  -1: malformed, or spaces around '='.
+    while (p < end && is_space(*p)) ++p;
+    if (p >= end) return -1;
+    if (*p == '>') {
+        ++p;
+        empty = false;
+        return 0;
+    }
+    if (*p == '/') {
+        if (p + 1 >= end || p[1] != '>') return -1;
+        p += 2;
+        empty = true;
+        return 0;
+    }
+    attr.name = p;
+    while (p < end && *p != '=' && *p != '>' && *p != '/' && !is_space(*p)) ++p;
+    attr.name_size = p - attr.name;
+    if (attr.name_size == 0 || p + 1 >= end || *p != '=') return -1;
+    char q = p[1];
+    if (q != '"' && q != '\'') return -1;
+    attr.value = p + 2;
+    auto close = find(attr.value, end, q);
+    if (close == end) return -1;
+    attr.value_size = close - attr.value;
+    p = close + 1;
+    return 1;
+}
+
+inline bool parse_uint(const char* p, size_t n, int& v) {
+    // digits only. empty is 0, like pugixml as_int().
+    if (n > 9) return false;
+    v = 0;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned d = static_cast<unsigned char>(p[i]) - '0';
+        if (d > 9) return false;
+        v = v * 10 + d;
+    }
+    return true;
+}
+
+inline bool parse_ref(const char* p, size_t n, int& rowx, int& colx) {
+    // "AB12" -> rowx=11, colx=27.
+    size_t i = 0;
+    colx = 0;
+    for (; i < n && i < 4; ++i) {
+        unsigned c = static_cast<unsigned char>(p[i]) - 'A';
+        if (c > 25) break;
+        colx = colx * 26 + c + 1;
+    }
+    if (i == 0 || i == n || i == 4) return false;
+    int row;
+    if (!parse_uint(p + i, n - i, row)) return false;
+    rowx = row - 1;
+    colx--;
+    return true;
+}
+
+inline int text_kind(const char* p, size_t n) {
+    // pcdata as pugixml would give it.
+    //   1: as is.
+    //   0: whitespace only. pugixml drops it.
+    //  -1: has entities or CR. needs pugixml.
+    int kind = 0;
+    for (size_t i = 0; i < n; ++i) {
+        char c = p[i];
+        if (c == '&' || c == '\r') return -1;
+        if (!is_space(c)) kind = 1;
+    }
+    return kind;
+}
+
+}  // namespace sheetdata
+}  // namespace xlsx
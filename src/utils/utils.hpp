@@ -12,6 +12,7 @@
 #include <tuple>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
 #include <list>
 #include <unordered_map>
 #include <clocale>
@@ -378,45 +379,120 @@ struct mutex_map {
     }
 };
 
+struct memory_budget {
+    // admits work while the estimated bytes it holds fit in limit.
+    // a key held by several works at once (a shared workbook) counts once.
+    // work is always admitted when none is held, so one larger than limit still runs.
+    using Items = std::vector<std::pair<std::string, size_t>>;  // key, bytes
+    std::mutex mutex;
+    std::condition_variable released;
+    size_t limit;
+    size_t used = 0;
+    std::unordered_map<std::string, std::pair<size_t, int>> held;  // key -> bytes, holders
+
+    inline explicit memory_budget(size_t limit_) : limit(limit_) {}
+
+    inline bool acquire(const Items& items, bool wait) {
+        // false: it does not fit now, and wait is false.
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            size_t needed = 0;
+            for (auto& item : items) {
+                if (held.count(item.first) == 0) needed += item.second;
+            }
+            if (used == 0 || used + needed <= limit) break;
+            if (!wait) return false;
+            released.wait(lock);
+        }
+        for (auto& item : items) {
+            auto& h = held[item.first];
+            if (h.second++ == 0) {
+                h.first = item.second;
+                used += item.second;
+            }
+        }
+        return true;
+    }
+
+    inline void release(const Items& items) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& item : items) {
+                auto it = held.find(item.first);
+                if (it == held.end() || --it->second.second > 0) continue;
+                used -= it->second.first;
+                held.erase(it);
+            }
+        }
+        released.notify_all();
+    }
+};
+
 template<class K, class V>
 struct shared_cache {
+    // one V per key, constructed once. entries can be erased while in use:
+    // holders keep theirs, and the next get constructs a new one.
     // using M = utils::spinlock;
     using M = std::mutex;
     struct Value {
         std::shared_ptr<V> v;
-        std::unique_ptr<M> mutex;
-        inline Value()
-            :v(nullptr), mutex(std::unique_ptr<M>(new M)) {}
+        M mutex;
+        uint64_t used = 0;  // tick of the last get.
+        size_t size = 0;    // last measured, see trim().
     };
     M mutex;
-    std::unordered_map<K, Value> map;
+    std::unordered_map<K, std::shared_ptr<Value>> map;
+    uint64_t tick = 0;
 
     template<class...A>
     std::shared_ptr<V> get_or_emplace(K k, A...a) {
-        Value* value;
+        std::shared_ptr<Value> value;
         {
             std::lock_guard<M> lock(mutex);
-            auto it = map.find(k);
-            if (it != map.end()) {
-                if (it->second.v.get() == nullptr) {
-                    value = &it->second;
-                } else {
-                    return it->second.v;
-                }
-            } else {
-                auto em = map.emplace(std::piecewise_construct,
-                                      std::make_tuple(k),
-                                      std::make_tuple());
-                value = &em.first->second;
-            }
+            auto& slot = map[k];
+            if (slot.get() == nullptr) slot = std::make_shared<Value>();
+            slot->used = ++tick;
+            value = slot;
         }
-        std::lock_guard<M> value_lock(*value->mutex);
-        if (value->v.get() != nullptr) {
-            return value->v;
+        std::lock_guard<M> value_lock(value->mutex);
+        if (value->v.get() == nullptr) {
+            value->v = std::make_shared<V>(a...);
         }
-        value->v = std::make_shared<V>(a...);
         return value->v;
     }
+
+    inline void erase(const K& k) {
+        std::lock_guard<M> lock(mutex);
+        map.erase(k);
+    }
+
+    inline void clear() {
+        std::lock_guard<M> lock(mutex);
+        map.clear();
+    }
+
+    inline void trim(size_t budget, std::function<size_t(V&)> size_of) {
+        // erases least recently used values no one holds, while the total is over budget.
+        // values in use count as last measured.
+        std::lock_guard<M> lock(mutex);
+        size_t total = 0;
+        std::vector<std::pair<uint64_t, K>> idle;
+        for (auto& kv : map) {
+            auto& value = kv.second;
+            // the slot is copied under this lock, and v is held after it.
+            if (value.use_count() == 1 && value->v.use_count() == 1) {
+                value->size = size_of(*value->v);
+                idle.emplace_back(value->used, kv.first);
+            }
+            total += value->size;
+        }
+        std::sort(idle.begin(), idle.end());
+        for (auto& e : idle) {
+            if (total <= budget) break;
+            total -= map[e.second]->size;
+            map.erase(e.second);
+        }
+    }
 };
 
 inline bool isdigits(const std::string& s) {
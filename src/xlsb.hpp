@@ -0,0 +1,238 @@
+// Copyright (c) 2016 peposso All Rights Reserved.
+// Released under the MIT license
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stddef.h>
+#include <string>
+
+namespace xlsx {
+namespace xlsb {
+
+// BIFF12 records of the binary workbook (.xlsb, [MS-XLSB]).
+// only what Workbook, SharedStrings, StyleSheet and Sheet need.
+// cells are given as the text and t attribute the xml would have, so they are typed
+// by CellTable::set like any other cell.
+
+enum : int {
+    kRowHdr = 0,
+    kCellBlank = 1,
+    kCellRk = 2,
+    kCellError = 3,
+    kCellBool = 4,
+    kCellReal = 5,
+    kCellSt = 6,
+    kCellIsst = 7,
+    kFmlaString = 8,
+    kFmlaNum = 9,
+    kFmlaBool = 10,
+    kFmlaError = 11,
+    kSSTItem = 19,
+    kFmt = 44,
+    kXF = 47,
+    kBeginSheetData = 145,
+    kEndSheetData = 146,
+    kWsDim = 148,
+    kBundleSh = 156,
+    kBeginCellXFs = 617,
+    kEndCellXFs = 618,
+};
+
+struct Record {
+    int type;
+    const char* data;
+    size_t size;
+};
+
+inline uint32_t le32(const char* p) {
+    auto u = reinterpret_cast<const uint8_t*>(p);
+    return u[0] | (u[1] << 8) | (u[2] << 16) | (static_cast<uint32_t>(u[3]) << 24);
+}
+
+inline uint16_t le16(const char* p) {
+    auto u = reinterpret_cast<const uint8_t*>(p);
+    return u[0] | (u[1] << 8);
+}
+
+inline int next_record(const char*& p, const char* end, Record& record) {
+    // type: 1-2 bytes, size: 1-4 bytes, 7 bits each. p moves after the record.
+    //   1: record is read.
+    //   0: end of data.
+    //  -1: malformed or truncated.
+    if (p >= end) return 0;
+    int type = 0;
+    for (int i = 0;; ++i) {
+        if (p >= end || i == 2) return -1;
+        uint8_t b = *p++;
+        type |= (b & 0x7f) << (7 * i);
+        if ((b & 0x80) == 0) break;
+    }
+    size_t size = 0;
+    for (int i = 0;; ++i) {
+        if (p >= end || i == 4) return -1;
+        uint8_t b = *p++;
+        size |= static_cast<size_t>(b & 0x7f) << (7 * i);
+        if ((b & 0x80) == 0) break;
+    }
+    if (static_cast<size_t>(end - p) < size) return -1;
+    record.type = type;
+    record.data = p;
+    record.size = size;
+    p += size;
+    return 1;
+}
+
+inline bool is_cell(int type) {
+    return kCellBlank <= type && type <= kFmlaError;
+}
+
+inline void append_utf8(std::string& out, uint32_t c) {
+    if (c < 0x80) {
+        out.push_back(c);
+    } else if (c < 0x800) {
+        out.push_back(0xc0 | (c >> 6));
+        out.push_back(0x80 | (c & 0x3f));
+    } else if (c < 0x10000) {
+        out.push_back(0xe0 | (c >> 12));
+        out.push_back(0x80 | ((c >> 6) & 0x3f));
+        out.push_back(0x80 | (c & 0x3f));
+    } else {
+        out.push_back(0xf0 | (c >> 18));
+        out.push_back(0x80 | ((c >> 12) & 0x3f));
+        out.push_back(0x80 | ((c >> 6) & 0x3f));
+        out.push_back(0x80 | (c & 0x3f));
+    }
+}
+
+inline bool read_string(const char*& p, const char* end, std::string& out) {
+    // XLWideString: uint32 count, utf-16le. appended to out as utf-8.
+    // a lone surrogate is U+FFFD. 0xffffffff is the null of XLNullableWideString.
+    if (end - p < 4) return false;
+    uint32_t n = le32(p);
+    p += 4;
+    if (n == 0xffffffff) return true;
+    if (static_cast<size_t>(end - p) / 2 < n) return false;
+    auto q = p + static_cast<size_t>(n) * 2;
+    while (p < q) {
+        uint32_t c = le16(p);
+        p += 2;
+        if (0xd800 <= c && c < 0xdc00 && p < q) {
+            uint32_t d = le16(p);
+            if (0xdc00 <= d && d < 0xe000) {
+                p += 2;
+                c = 0x10000 + ((c - 0xd800) << 10) + (d - 0xdc00);
+            }
+        }
+        if (0xd800 <= c && c < 0xe000) c = 0xfffd;
+        append_utf8(out, c);
+    }
+    return true;
+}
+
+inline double rk_number(uint32_t rk) {
+    // RkNumber: bit 0 is x100, bit 1 is int. the rest is an int30, or the high bits of a double.
+    double d;
+    if (rk & 2) {
+        d = static_cast<int32_t>(rk & 0xfffffffc) / 4;
+    } else {
+        uint64_t bits = static_cast<uint64_t>(rk & 0xfffffffc) << 32;
+        memcpy(&d, &bits, sizeof(d));
+    }
+    if (rk & 1) d /= 100;
+    return d;
+}
+
+inline void format_number(double d, std::string& out) {
+    // like <v> of the xml. integral values have no dot, so they are int cells there too.
+    char buf[32];
+    int n = 0;
+    if (d == floor(d) && d >= -9223372036854775808.0 && d < 9223372036854775808.0) {
+        // digits, not "1E+15", up to the int64 range.
+        if (d == 0) d = 0;  // not "-0".
+        n = snprintf(buf, sizeof(buf), "%.0f", d);
+        out.append(buf, n);
+        return;
+    }
+    for (int precision = 15; precision <= 17; ++precision) {
+        n = snprintf(buf, sizeof(buf), "%.*g", precision, d);
+        if (strtod(buf, nullptr) == d) break;
+    }
+    for (int i = 0; i < n; ++i) {
+        if (buf[i] == 'e') buf[i] = 'E';
+    }
+    out.append(buf, n);
+}
+
+inline const char* error_text(uint8_t code) {
+    switch (code) {
+        case 0x00: return "#NULL!";
+        case 0x07: return "#DIV/0!";
+        case 0x0f: return "#VALUE!";
+        case 0x17: return "#REF!";
+        case 0x1d: return "#NAME?";
+        case 0x24: return "#NUM!";
+        case 0x2a: return "#N/A";
+        case 0x2b: return "#GETTING_DATA";
+        default: return "#N/A";
+    }
+}
+
+inline bool read_cell(const Record& record, int& colx, int& s,
+                      std::string& v, const char*& t) {
+    // cell record to the <v> text and t attribute of the xml cell.
+    // false: malformed.
+    if (record.size < 8) return false;
+    auto p = record.data + 8;
+    auto end = record.data + record.size;
+    colx = le32(record.data);
+    s = le32(record.data + 4) & 0xffffff;
+    v.clear();
+    t = "";
+    switch (record.type) {
+        case kCellBlank:
+            return true;
+        case kCellRk:
+            if (end - p < 4) return false;
+            format_number(rk_number(le32(p)), v);
+            return true;
+        case kCellReal:
+        case kFmlaNum: {
+            if (end - p < 8) return false;
+            double d;
+            memcpy(&d, p, sizeof(d));
+            format_number(d, v);
+            return true;
+        }
+        case kCellBool:
+        case kFmlaBool:
+            if (end - p < 1) return false;
+            v.push_back(*p != 0 ? '1' : '0');
+            t = "b";
+            return true;
+        case kCellError:
+        case kFmlaError:
+            if (end - p < 1) return false;
+            v = error_text(*p);
+            t = "e";
+            return true;
+        case kCellIsst: {
+            if (end - p < 4) return false;
+            char buf[16];
+            v.append(buf, snprintf(buf, sizeof(buf), "%u", le32(p)));
+            t = "s";
+            return true;
+        }
+        case kCellSt:
+        case kFmlaString:
+            t = "str";
+            return read_string(p, end, v);
+        default:
+            return false;
+    }
+}
+
+}  // namespace xlsb
+}  // namespace xlsx
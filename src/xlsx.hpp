@@ -2,6 +2,13 @@
 // Released under the MIT license
 #pragma once
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/file.h>
+#endif
+#include <errno.h>
 #include <tuple>
 #include <string>
 #include <vector>
@@ -14,10 +21,30 @@
 #include <exception>
 #include <utility>
 #include <random>
-
-#include <ZipFile.h>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <functional>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <extlibs/zlib/zlib.h>
 #include <pugixml.hpp>
 
+#include "inflate.hpp"
+#include "sheetdata.hpp"
+#include "xlsb.hpp"
+#include "csvdata.hpp"
+
+#ifdef O_BINARY
+#define O_BINARY_ O_BINARY
+#else
+#define O_BINARY_ 0
+#endif
+
 namespace xlsx {
 
 template<class T>
@@ -43,6 +70,12 @@ inline bool& verbose() {
     return verbose_;
 }
 
+inline std::string& snapshot_dir() {
+    // decoded sheets are kept here across runs, if set. see Snapshot.
+    static std::string snapshot_dir_;
+    return snapshot_dir_;
+}
+
 inline std::mutex& log_mutex() {
     static std::mutex log_mutex_;
     return log_mutex_;
@@ -62,12 +95,497 @@ struct Exception: std::runtime_error {
 };
 
 
+struct Inflater {
+    // decompression backend for whole deflated entries (raw deflate).
+    // out_size is the exact inflated size. false: broken data.
+    virtual ~Inflater() {}
+    virtual const char* name() = 0;
+    virtual bool inflate(const char* in, size_t in_size, char* out, size_t out_size) = 0;
+};
+
+struct ZlibInflater : Inflater {
+    inline const char* name() override { return "zlib"; }
+
+    inline
+    bool inflate(const char* in, size_t in_size, char* out, size_t out_size) override {
+        static const size_t max_avail = 1 << 30;  // avail_in/out are 32bit.
+        z_stream zs;
+        std::memset(&zs, 0, sizeof(zs));
+        if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) return false;
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+        zs.next_out = reinterpret_cast<Bytef*>(out);
+        size_t in_left = in_size;
+        size_t out_left = out_size;
+        int ret = Z_OK;
+        while (ret == Z_OK) {
+            if (zs.avail_in == 0 && in_left > 0) {
+                zs.avail_in = std::min(in_left, max_avail);
+                in_left -= zs.avail_in;
+            }
+            if (zs.avail_out == 0 && out_left > 0) {
+                zs.avail_out = std::min(out_left, max_avail);
+                out_left -= zs.avail_out;
+            }
+            ret = ::inflate(&zs, Z_NO_FLUSH);
+        }
+        size_t n = zs.total_out;
+        inflateEnd(&zs);
+        return ret == Z_STREAM_END && n == out_size;
+    }
+};
+
+struct FastInflater : Inflater {
+    // one-shot decoder in inflate.hpp.
+    inline const char* name() override { return "fast"; }
+
+    inline
+    bool inflate(const char* in, size_t in_size, char* out, size_t out_size) override {
+        size_t n = 0;
+        auto result = xlsx::inflate::inflate(in, in_size, out, out_size, &n);
+        return result == xlsx::inflate::kOk && n == out_size;
+    }
+};
+
+inline std::shared_ptr<Inflater>& default_inflater() {
+    static std::shared_ptr<Inflater> default_inflater_ = std::make_shared<FastInflater>();
+    return default_inflater_;
+}
+
+struct MappedFile {
+    // a whole file, read-only. read into memory if it cant be mapped.
+    std::string path;
+    const char* data = nullptr;
+    size_t size = 0;
+    std::string owned_;
+    bool mapped_ = false;
+
+    inline
+    explicit MappedFile(const std::string& path_) : path(path_) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_BINARY_);
+        if (fd < 0) {
+            throw Exception("file=", path, ": cant open.");
+        }
+        struct stat statbuf;
+        if (::fstat(fd, &statbuf) != 0) {
+            ::close(fd);
+            throw Exception("file=", path, ": cant stat.");
+        }
+        size = statbuf.st_size;
+#ifndef _WIN32
+        if (size > 0) {
+            void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data = static_cast<const char*>(p);
+                mapped_ = true;
+            }
+        }
+#endif
+        if (!mapped_) {
+            owned_.resize(size);
+            size_t n = 0;
+            while (n < size) {
+                auto r = ::read(fd, &owned_[n], size - n);
+                if (r <= 0) {
+                    ::close(fd);
+                    throw Exception("file=", path, ": read error.");
+                }
+                n += r;
+            }
+            data = owned_.data();
+        }
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapped_) ::munmap(const_cast<char*>(data), size);
+#endif
+    }
+};
+
+
+struct ZipReader {
+    // zip archive reader on mmap, or on positional reads (pread).
+    // entries can be read from many threads at the same time.
+    struct Entry {
+        std::string name;
+        int method = 0;  // 0: stored, 8: deflated
+        uint32_t crc32 = 0;
+        uint64_t compressed_size = 0;
+        uint64_t size = 0;
+        uint64_t header_offset = 0;  // local file header
+    };
+
+    struct Stream {
+        // sequential reader of one entry. owned by one thread.
+        // deflated data is inflated straight from the mapping if mapped.
+        static const size_t chunk_size = 64 * 1024;
+        static const size_t map_chunk_size = 1 << 30;  // avail_in is 32bit.
+
+        ZipReader* reader;
+        const Entry* entry;
+        uint64_t offset;  // next compressed byte in file
+        uint64_t remain;  // compressed bytes not read yet
+        std::vector<char> input;
+        z_stream zs;
+        bool eof = false;
+        uint32_t crc = 0;  // of the bytes read so far.
+
+        inline
+        Stream(ZipReader* reader_, const Entry* entry_)
+                : reader(reader_), entry(entry_),
+                  offset(reader_->data_offset(*entry_)),
+                  remain(entry_->compressed_size) {
+            std::memset(&zs, 0, sizeof(zs));
+            if (entry->method == 8) {
+                if (reader->map_ == nullptr) input.resize(chunk_size);
+                if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+                    throw Exception("entry=", entry->name, ": inflateInit2 failed.");
+                }
+            }
+        }
+
+        Stream(const Stream&) = delete;
+        Stream& operator=(const Stream&) = delete;
+
+        inline
+        ~Stream() {
+            if (entry->method == 8) inflateEnd(&zs);
+        }
+
+        inline
+        size_t read(char* buffer, size_t size) {
+            // returns read bytes. less than size at the end of entry.
+            if (entry->method == 0) {
+                size_t n = std::min<uint64_t>(size, remain);
+                reader->read_at(offset, buffer, n);
+                offset += n;
+                remain -= n;
+                return n;
+            }
+            bool was_eof = eof;
+            zs.next_out = reinterpret_cast<Bytef*>(buffer);
+            zs.avail_out = size;
+            while (zs.avail_out > 0 && !eof) {
+                if (zs.avail_in == 0 && remain > 0) {
+                    size_t n;
+                    if (reader->map_ != nullptr) {
+                        n = std::min<uint64_t>(uint64_t(map_chunk_size), remain);
+                        zs.next_in = reinterpret_cast<Bytef*>(
+                            const_cast<char*>(reader->map(offset, n)));
+                    } else {
+                        n = std::min<uint64_t>(input.size(), remain);
+                        reader->read_at(offset, input.data(), n);
+                        zs.next_in = reinterpret_cast<Bytef*>(input.data());
+                    }
+                    offset += n;
+                    remain -= n;
+                    zs.avail_in = n;
+                }
+                auto ret = ::inflate(&zs, Z_NO_FLUSH);
+                if (ret == Z_STREAM_END) {
+                    eof = true;
+                } else if (ret == Z_BUF_ERROR && zs.avail_in == 0 && remain == 0) {
+                    throw Exception("entry=", entry->name, ": unexpected end of data.");
+                } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                    throw Exception("entry=", entry->name, ": inflate error=", ret);
+                }
+            }
+            size_t n = size - zs.avail_out;
+            crc = checksum(buffer, n, crc);
+            if (eof && !was_eof && crc != entry->crc32) {
+                throw Exception("entry=", entry->name, ": crc32 mismatch.");
+            }
+            return n;
+        }
+    };
+
+    std::string path;
+    int fd = -1;
+    uint64_t file_size = 0;
+    std::vector<Entry> entries;
+    std::shared_ptr<Inflater> inflater = default_inflater();  // for read_entry.
+    const char* map_ = nullptr;  // nullptr: pread backend.
+#ifdef _WIN32
+    std::mutex read_mutex;  // no pread.
+#endif
+
+    inline
+    explicit ZipReader(const std::string& path_, bool use_mmap = true) : path(path_) {
+        fd = ::open(path.c_str(), O_RDONLY | O_BINARY_);
+        if (fd < 0) {
+            throw Exception("file=", path, ": cant open.");
+        }
+        try {
+            struct stat statbuf;
+            if (::fstat(fd, &statbuf) != 0) {
+                throw Exception("file=", path, ": cant stat.");
+            }
+            file_size = statbuf.st_size;
+#ifndef _WIN32
+            if (use_mmap && file_size > 0) {
+                // falls back to pread if it cant be mapped.
+                void* p = ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) map_ = static_cast<const char*>(p);
+            }
+#endif
+            read_central_directory();
+        } catch (...) {
+            unmap();
+            ::close(fd);
+            throw;
+        }
+    }
+
+    ZipReader(const ZipReader&) = delete;
+    ZipReader& operator=(const ZipReader&) = delete;
+
+    inline
+    ~ZipReader() {
+        unmap();
+        if (fd >= 0) ::close(fd);
+    }
+
+    inline
+    void unmap() {
+#ifndef _WIN32
+        if (map_ != nullptr) ::munmap(const_cast<char*>(map_), file_size);
+#endif
+        map_ = nullptr;
+    }
+
+    inline
+    bool mapped() {
+        return map_ != nullptr;
+    }
+
+    inline
+    size_t size() {
+        return entries.size();
+    }
+
+    inline
+    const Entry& entry(int index) {
+        if (index < 0 || entries.size() <= static_cast<size_t>(index)) {
+            throw Exception("entry_index=", index, ": out of range.");
+        }
+        return entries[index];
+    }
+
+    inline
+    const char* map(uint64_t offset, size_t size) {
+        // pointer into the mapping. requires mapped().
+        if (offset + size > file_size) {
+            throw Exception("file=", path, ": read out of range. offset=", offset);
+        }
+        return map_ + offset;
+    }
+
+    inline
+    void read_at(uint64_t offset, char* buffer, size_t size) {
+        if (offset + size > file_size) {
+            throw Exception("file=", path, ": read out of range. offset=", offset);
+        }
+        if (map_ != nullptr) {
+            std::memcpy(buffer, map_ + offset, size);
+            return;
+        }
+#ifdef _WIN32
+        std::lock_guard<std::mutex> lock(read_mutex);
+        if (_lseeki64(fd, offset, SEEK_SET) < 0) {
+            throw Exception("file=", path, ": seek error.");
+        }
+#endif
+        while (size > 0) {
+#ifdef _WIN32
+            auto n = ::read(fd, buffer, size);
+#else
+            auto n = ::pread(fd, buffer, size, offset);
+#endif
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                throw Exception("file=", path, ": read error. offset=", offset);
+            }
+            buffer += n;
+            offset += n;
+            size -= n;
+        }
+    }
+
+    inline
+    uint64_t data_offset(const Entry& entry) {
+        // local file header: 30 bytes + name + extra.
+        char header[30];
+        read_at(entry.header_offset, header, sizeof(header));
+        if (le32(header) != 0x04034b50) {
+            throw Exception("entry=", entry.name, ": bad local header.");
+        }
+        return entry.header_offset + 30 + le16(header + 26) + le16(header + 28);
+    }
+
+    inline
+    void read_entry(int index, char* buffer, size_t size) {
+        // whole entry into buffer. size is entry(index).size.
+        auto& e = entry(index);
+        if (size != e.size) {
+            throw Exception("entry=", e.name, ": size=", e.size, " buffer=", size);
+        }
+        if (e.method == 0) {
+            read_at(data_offset(e), buffer, size);
+            return;
+        }
+        if (e.method != 8) {
+            throw Exception("entry=", e.name, ": unsupported method=", e.method);
+        }
+        auto offset = data_offset(e);
+        bool ok;
+        if (map_ != nullptr) {
+            ok = inflater->inflate(map(offset, e.compressed_size), e.compressed_size,
+                                   buffer, size);
+        } else {
+            std::vector<char> input(e.compressed_size);
+            read_at(offset, input.data(), input.size());
+            ok = inflater->inflate(input.data(), input.size(), buffer, size);
+        }
+        if (!ok) {
+            throw Exception("entry=", e.name, ": broken. inflater=", inflater->name());
+        }
+        if (checksum(buffer, size) != e.crc32) {
+            throw Exception("entry=", e.name, ": crc32 mismatch. inflater=", inflater->name());
+        }
+    }
+
+    static inline
+    uint32_t checksum(const char* p, size_t size, uint32_t crc = 0) {
+        // crc32 of zlib, in pieces. its length is 32bit.
+        for (size_t n; size > 0; p += n, size -= n) {
+            n = std::min<size_t>(size, 1 << 30);
+            crc = ::crc32(crc, reinterpret_cast<const Bytef*>(p), n);
+        }
+        return crc;
+    }
+
+    inline
+    const char* view(int index) {
+        // zero-copy contents of a stored entry. nullptr if deflated or not mapped.
+        auto& e = entry(index);
+        if (map_ == nullptr || e.method != 0) return nullptr;
+        return map(data_offset(e), e.size);
+    }
+
+    inline
+    std::unique_ptr<Stream> stream(int index) {
+        auto& e = entry(index);
+        if (e.method != 0 && e.method != 8) {
+            throw Exception("entry=", e.name, ": unsupported method=", e.method);
+        }
+        return std::unique_ptr<Stream>(new Stream(this, &e));
+    }
+
+    inline
+    void read_central_directory() {
+        // end of central directory record is in the last 64KB + 22 bytes.
+        uint64_t tail_size = std::min<uint64_t>(file_size, 0xffff + 22);
+        std::vector<char> tail(tail_size);
+        read_at(file_size - tail_size, tail.data(), tail_size);
+        int64_t eocd = -1;
+        for (int64_t p = tail_size - 22; p >= 0; --p) {
+            if (le32(&tail[p]) == 0x06054b50) {
+                eocd = p;
+                break;
+            }
+        }
+        if (eocd < 0) {
+            throw Exception("file=", path, ": not a zip file.");
+        }
+        uint64_t count = le16(&tail[eocd + 10]);
+        uint64_t cd_size = le32(&tail[eocd + 12]);
+        uint64_t cd_offset = le32(&tail[eocd + 16]);
+        if (eocd >= 20 && le32(&tail[eocd - 20]) == 0x07064b50) {
+            // zip64 end of central directory locator.
+            char record[56];
+            read_at(le64(&tail[eocd - 20 + 8]), record, sizeof(record));
+            if (le32(record) != 0x06064b50) {
+                throw Exception("file=", path, ": bad zip64 record.");
+            }
+            count = le64(record + 32);
+            cd_size = le64(record + 40);
+            cd_offset = le64(record + 48);
+        }
+
+        std::vector<char> cd(cd_size);
+        read_at(cd_offset, cd.data(), cd_size);
+        entries.reserve(count);
+        size_t p = 0;
+        for (uint64_t i = 0; i < count; ++i) {
+            if (p + 46 > cd.size() || le32(&cd[p]) != 0x02014b50) {
+                throw Exception("file=", path, ": bad central directory.");
+            }
+            auto h = &cd[p];
+            Entry e;
+            e.method = le16(h + 10);
+            e.crc32 = le32(h + 16);
+            e.compressed_size = le32(h + 20);
+            e.size = le32(h + 24);
+            size_t name_size = le16(h + 28);
+            size_t extra_size = le16(h + 30);
+            size_t comment_size = le16(h + 32);
+            e.header_offset = le32(h + 42);
+            if (p + 46 + name_size + extra_size > cd.size()) {
+                throw Exception("file=", path, ": bad central directory.");
+            }
+            e.name.assign(h + 46, name_size);
+            // zip64 extended information.
+            auto extra = h + 46 + name_size;
+            for (size_t q = 0; q + 4 <= extra_size;) {
+                size_t id = le16(extra + q);
+                size_t len = le16(extra + q + 2);
+                auto x = extra + q + 4;
+                if (id == 0x0001) {
+                    if (e.size == 0xffffffff) e.size = le64(x), x += 8;
+                    if (e.compressed_size == 0xffffffff) e.compressed_size = le64(x), x += 8;
+                    if (e.header_offset == 0xffffffff) e.header_offset = le64(x);
+                }
+                q += 4 + len;
+            }
+            entries.push_back(std::move(e));
+            p += 46 + name_size + extra_size + comment_size;
+        }
+    }
+
+    static inline
+    uint64_t le16(const char* p) {
+        auto u = reinterpret_cast<const uint8_t*>(p);
+        return u[0] | (u[1] << 8);
+    }
+
+    static inline
+    uint64_t le32(const char* p) {
+        return le16(p) | (le16(p + 2) << 16);
+    }
+
+    static inline
+    uint64_t le64(const char* p) {
+        return le32(p) | (le32(p + 4) << 32);
+    }
+};
+
+
 struct StyleSheet {
     std::vector<int> num_fmts_by_xf_index;
     std::unordered_map<int, std::string> format_codes;
 
-    std::unordered_map<int, bool> is_date_table_;
-    std::mutex mutex_;
+    // date or not, for each cellXfs index. frozen after parse(), so no lock to read.
+    std::vector<uint8_t> date_by_xf_index;
+
+    // styles.xml (styles.bin) is parsed on first use. loader calls parse().
+    std::function<void(StyleSheet&)> loader;
+    std::atomic<bool> loaded_;
+    std::mutex load_mutex_;
     /*
     numFmts.
     # "std" == "standard for US English locale"
@@ -133,27 +651,93 @@ struct StyleSheet {
     }
 
     inline
-    explicit StyleSheet(std::unique_ptr<pugi::xml_document> doc) {
-        auto ss = doc->child("styleSheet");
+    explicit StyleSheet(std::unique_ptr<pugi::xml_document> doc) : loaded_(true) {
+        parse(*doc);
+    }
+
+    inline
+    explicit StyleSheet(std::function<void(StyleSheet&)> loader_)
+            : loader(loader_), loaded_(false) {}
+
+    inline
+    void load() {
+        if (loaded_.load(std::memory_order_acquire)) return;
+        std::lock_guard<std::mutex> lock(load_mutex_);
+        if (loaded_.load(std::memory_order_relaxed)) return;
+        loader(*this);
+        loaded_.store(true, std::memory_order_release);
+    }
+
+    inline
+    void parse(pugi::xml_document& doc) {
+        auto ss = doc.child("styleSheet");
         for (auto& nf : ss.child("numFmts").children("numFmt")) {
             int fmtid = nf.attribute("numFmtId").as_int();
             auto fmtcode = nf.attribute("formatCode").as_string();
             format_codes[fmtid] = fmtcode;
         }
         for (auto& xf : ss.child("cellXfs").children("xf")) {
-            int fmtid = xf.attribute("numFmtId").as_int();
-            num_fmts_by_xf_index.push_back(fmtid);
+            num_fmts_by_xf_index.push_back(xf.attribute("numFmtId").as_int());
+        }
+        freeze();
+    }
+
+    inline
+    void parse(const char* p, size_t size) {
+        // styles.bin: BrtFmt, and BrtXF in BrtBeginCellXFs (not the cellStyleXfs ones).
+        auto end = p + size;
+        xlsb::Record record;
+        bool cell_xfs = false;
+        int r;
+        while ((r = xlsb::next_record(p, end, record)) == 1) {
+            if (record.type == xlsb::kFmt) {
+                // ifmt, stFmtCode.
+                auto q = record.data + 2;
+                std::string code;
+                if (record.size < 2 ||
+                        !xlsb::read_string(q, record.data + record.size, code)) {
+                    throw Exception("styles.bin: bad BrtFmt.");
+                }
+                format_codes[xlsb::le16(record.data)] = code;
+            } else if (record.type == xlsb::kBeginCellXFs) {
+                cell_xfs = true;
+            } else if (record.type == xlsb::kEndCellXFs) {
+                cell_xfs = false;
+            } else if (record.type == xlsb::kXF && cell_xfs) {
+                // ixfeParent, iFmt, ...
+                if (record.size < 4) throw Exception("styles.bin: bad BrtXF.");
+                num_fmts_by_xf_index.push_back(xlsb::le16(record.data + 2));
+            }
+        }
+        if (r < 0) throw Exception("styles.bin: unexpected eof.");
+        freeze();
+    }
+
+    inline
+    void freeze() {
+        // classified once per numFmtId.
+        std::unordered_map<int, bool> date_by_fmtid;
+        for (auto fmtid : num_fmts_by_xf_index) {
+            auto it = date_by_fmtid.find(fmtid);
+            if (it == date_by_fmtid.end()) {
+                it = date_by_fmtid.emplace(fmtid, classify(fmtid)).first;
+            }
+            date_by_xf_index.push_back(it->second ? 1 : 0);
         }
     }
 
     inline
     bool is_date_format(int xf_index) {
-        // SEE: https://github.com/python-excel/xlrd/blob/master/xlrd/formatting.py
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = is_date_table_.find(xf_index);
-        if (it != is_date_table_.end()) return it->second;
+        load();
+        if (xf_index < 0 || date_by_xf_index.size() <= static_cast<size_t>(xf_index)) {
+            return false;
+        }
+        return date_by_xf_index[xf_index] != 0;
+    }
 
-        auto fmtid = num_fmts_by_xf_index[xf_index];
+    inline
+    bool classify(int fmtid) {
+        // SEE: https://github.com/python-excel/xlrd/blob/master/xlrd/formatting.py
         // standard formats.
         if (0x0e <= fmtid && fmtid <= 0x16) return true;
         if (0x2d <= fmtid && fmtid <= 0x2f) return true;
@@ -161,10 +745,7 @@ struct StyleSheet {
         // 0-13: false, 14-22: true, 23-44: false, 45-47: true, 47-49: false
 
         auto code = format_codes[fmtid];
-        if (non_date_formats().count(code) == 1) {
-            is_date_table_[xf_index] = false;
-            return false;
-        }
+        if (non_date_formats().count(code) == 1) return false;
 
         // Heuristics
         auto s = remove_bracketed(code);
@@ -180,17 +761,9 @@ struct StyleSheet {
                 got_sep = true;
             }
         }
-        if (date_count > 0 && num_count == 0) {
-            is_date_table_[xf_index] = true;
-            return true;
-        }
-        if (num_count > 0 && date_count == 0) {
-            is_date_table_[xf_index] = false;
-            return false;
-        }
-        bool r = date_count > num_count;
-        is_date_table_[xf_index] = r;
-        return r;
+        if (date_count > 0 && num_count == 0) return true;
+        if (num_count > 0 && date_count == 0) return false;
+        return date_count > num_count;
     }
 
     inline
@@ -213,102 +786,368 @@ struct StyleSheet {
 };
 
 
-struct Cell {
-    enum Type {
-        kEmpty, kString, kInt, kDouble, kDateTime, kBool,
-    };
+struct SharedStrings {
+    // <si> boundaries are indexed once, and each entry is decoded on first access.
+    // source is owned, or a view of a stored entry in the mapped archive.
+    // with a loader, nothing is read until the first access.
+    std::string owned;
+    std::shared_ptr<ZipReader> archive;
+    const char* source = nullptr;
+    size_t source_size = 0;
+    std::function<void(SharedStrings&)> loader;
+    std::atomic<bool> loaded_;
+    std::mutex load_mutex_;
+    std::vector<size_t> offsets;
+    std::vector<std::string> strings;
+    std::unique_ptr<std::atomic<bool>[]> decoded;
+    pugi::xml_document doc;
+    std::mutex mutex_;
 
-    std::string v;
-    int row = -1;
-    int col = -1;
-    Type type = Type::kEmpty;
+    inline
+    explicit SharedStrings(std::string source_) : loaded_(true) {
+        assign(std::move(source_));
+    }
 
     inline
-    Cell() : Cell(-1, -1) {}
+    SharedStrings(std::shared_ptr<ZipReader> archive_, const char* source_, size_t size)
+            : loaded_(true) {
+        assign(archive_, source_, size);
+    }
 
     inline
-    Cell(int row, int col) : Cell(row, col, "", "", -1, nullptr, nullptr) {}
+    explicit SharedStrings(std::function<void(SharedStrings&)> loader_)
+            : loader(loader_), loaded_(false) {}
 
     inline
-    Cell(int row, int col, std::string v_, std::string t, int s,
-         std::shared_ptr<std::vector<std::string>> shared_string,
-         std::shared_ptr<StyleSheet> style_sheet)
-        : row(row), col(col), v(v_) {
-        if (v == "") {
-            type = Type::kEmpty;
-        } else if (t == "s") {
-            type = Type::kString;
-            if (shared_string.get() == nullptr) {
-                throw Exception("invalid shared_string: nullptr");
-            }
-            int64_t i = std::stoll(v);
-            if (i < 0 || shared_string->size() <= i) {
-                throw Exception("invalid shared_string: invalid id=", i);
-            }
-            v = shared_string->at(i);
-        } else if (t == "b") {
-            type = Type::kBool;
-        } else {
-            if (s > 0 && style_sheet->is_date_format(s)) {
-                type = Type::kDateTime;
-            } else if (is_float_string(v)) {
-                type = Type::kDouble;
-            } else {
-                type = Type::kInt;
+    void assign(std::string source_) {
+        owned = std::move(source_);
+        source = owned.data();
+        source_size = owned.size();
+        index();
+    }
+
+    inline
+    void assign(std::shared_ptr<ZipReader> archive_, const char* source_, size_t size) {
+        archive = archive_;
+        source = source_;
+        source_size = size;
+        index();
+    }
+
+    inline
+    void assign_binary(const char* p, size_t size) {
+        // sharedStrings.bin: every BrtSSTItem is decoded now. there is no <si> to index.
+        auto end = p + size;
+        xlsb::Record record;
+        int r;
+        while ((r = xlsb::next_record(p, end, record)) == 1) {
+            if (record.type != xlsb::kSSTItem) continue;
+            // flags, str, and runs which are skipped.
+            auto q = record.data + 1;
+            std::string text;
+            if (record.size < 1 || !xlsb::read_string(q, record.data + record.size, text)) {
+                throw Exception("sharedStrings: bad BrtSSTItem. id=", strings.size());
             }
+            strings.push_back(std::move(text));
         }
+        if (r < 0) throw Exception("sharedStrings: unexpected eof.");
+        offsets.assign(strings.size() + 1, 0);
+        decoded = std::unique_ptr<std::atomic<bool>[]>(new std::atomic<bool>[strings.size()]);
+        for (size_t i = 0; i < strings.size(); ++i) decoded[i].store(true);
     }
 
     inline
-    bool is_float_string(std::string v) {
-        if (v.empty()) return false;
-        auto it = v.begin();
-        if (*it == '+' || *it == '-') ++it;
-        bool digit = false;
-        bool dot = false;
-        for (; it != v.end(); ++it) {
-            if ('0' <= *it && *it <= '9') {
-                digit = true;
-            } else if (*it == '.') {
-                if (dot) return false;
-                dot = true;
-            } else if (*it == 'E' || *it == 'e') {
-                if (!digit) return false;
-                ++it;
-                if (*it == '+' || *it == '-') ++it;
-                bool expdigit = false;
-                for (; it != v.end(); ++it) {
-                    if ('0' <= *it && *it <= '9') {
-                        expdigit = true;
-                    } else {
-                        return false;
-                    }
-                }
-                return expdigit;
-            } else {
-                return false;
+    void load() {
+        // loader calls assign().
+        if (loaded_.load(std::memory_order_acquire)) return;
+        std::lock_guard<std::mutex> lock(load_mutex_);
+        if (loaded_.load(std::memory_order_relaxed)) return;
+        loader(*this);
+        loaded_.store(true, std::memory_order_release);
+    }
+
+    inline
+    void index() {
+        size_t p = 0;
+        size_t end = 0;
+        for (;;) {
+            p = find("<si", p);
+            if (p == std::string::npos) break;
+            char c = p + 3 < source_size ? source[p + 3] : '\0';
+            if (c != '>' && c != '/' && c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+                p += 3;
+                continue;
+            }
+            offsets.push_back(p);
+            auto gt = find(">", p);
+            if (gt == std::string::npos) {
+                throw Exception("sharedStrings: unexpected eof.");
+            }
+            if (source[gt - 1] == '/') {
+                // <si/>
+                end = p = gt + 1;
+                continue;
+            }
+            p = find("</si>", gt);
+            if (p == std::string::npos) {
+                throw Exception("sharedStrings: unexpected eof.");
             }
+            end = p = p + 5;
         }
-        return dot;
+        offsets.push_back(end);
+        strings.resize(offsets.size() - 1);
+        decoded = std::unique_ptr<std::atomic<bool>[]>(new std::atomic<bool>[strings.size()]());
     }
 
     inline
-    std::string type_name() {
-        // for error.
-        switch (type) {
-            case (Type::kEmpty): return "empty";
-            case (Type::kString): return "string";
-            case (Type::kInt): return "int";
-            case (Type::kDouble): return "double";
-            case (Type::kDateTime): return "datetime";
-            case (Type::kBool): return "bool";
-        }
-        return "error";
+    size_t find(const char* needle, size_t from) {
+        auto end = source + source_size;
+        auto it = std::search(source + std::min(from, source_size), end,
+                              needle, needle + std::strlen(needle));
+        return it == end ? std::string::npos : it - source;
     }
 
     inline
-    std::string cellname() {
-        std::string name;
+    size_t size() {
+        load();
+        return offsets.size() - 1;
+    }
+
+    inline
+    size_t memory_size() {
+        // approximate. 0 until loaded.
+        if (!loaded_.load(std::memory_order_acquire)) return 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t size = owned.size() + offsets.size() * sizeof(size_t) +
+                      strings.size() * sizeof(std::string);
+        for (auto& s : strings) size += s.capacity();
+        return size;
+    }
+
+    inline
+    uint32_t crc32(size_t n) {
+        // of the first n entries as stored: <si> xml, or the text of xlsb items.
+        n = std::min(n, size());
+        uLong crc = ::crc32(0L, Z_NULL, 0);
+        if (source == nullptr) {
+            for (size_t i = 0; i < n; ++i) {
+                crc = ::crc32(crc, reinterpret_cast<const Bytef*>(strings[i].c_str()),
+                              strings[i].size() + 1);
+            }
+            return crc;
+        }
+        for (size_t p = offsets[0]; p < offsets[n];) {
+            size_t size = std::min<size_t>(offsets[n] - p, 1 << 30);
+            crc = ::crc32(crc, reinterpret_cast<const Bytef*>(source + p), size);
+            p += size;
+        }
+        return crc;
+    }
+
+    inline
+    const std::string& at(size_t i) {
+        if (size() <= i) {
+            throw Exception("invalid shared_string: invalid id=", i);
+        }
+        if (decoded[i].load(std::memory_order_acquire)) return strings[i];
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!decoded[i].load(std::memory_order_relaxed)) {
+            strings[i] = decode(i);
+            decoded[i].store(true, std::memory_order_release);
+        }
+        return strings[i];
+    }
+
+    inline
+    std::string decode(size_t i) {
+        auto result = doc.load_buffer(source + offsets[i], offsets[i + 1] - offsets[i],
+                                      pugi::parse_default, pugi::encoding_utf8);
+        if (!result) {
+            throw Exception("sharedStrings: parse error!! id=", i);
+        }
+        std::string text;
+        for (auto child : doc.child("si").children()) {
+            std::string name = child.name();
+            if (name == "t") {
+                text.append(child.text().as_string());
+            } else if (name == "r") {
+                for (auto node : child.children("t")) {
+                    text.append(node.text().as_string());
+                }
+            }
+        }
+        return text;
+    }
+};
+
+
+struct Cell {
+    enum Type {
+        kEmpty, kString, kInt, kDouble, kDateTime, kBool,
+    };
+    union Value {
+        int64_t i;
+        double d;
+    };
+
+    // view of a decoded cell. see CellTable.
+    int row = -1;
+    int col = -1;
+    Type type = Type::kEmpty;
+    Value value = {0};
+    const char* text = nullptr;
+    SharedStrings* shared_string = nullptr;
+    size_t shared_string_index = 0;
+
+    inline
+    Cell() : Cell(-1, -1) {}
+
+    inline
+    Cell(int row, int col) : row(row), col(col) {}
+
+    static inline
+    bool is_float_string(std::string v) {
+        return is_float_string(v.data(), v.size());
+    }
+
+    static inline
+    bool is_float_string(const char* v, size_t size) {
+        if (size == 0) return false;
+        auto it = v;
+        auto end = v + size;
+        if (*it == '+' || *it == '-') ++it;
+        bool digit = false;
+        bool dot = false;
+        for (; it != end; ++it) {
+            if ('0' <= *it && *it <= '9') {
+                digit = true;
+            } else if (*it == '.') {
+                if (dot) return false;
+                dot = true;
+            } else if (*it == 'E' || *it == 'e') {
+                if (!digit) return false;
+                ++it;
+                if (it != end && (*it == '+' || *it == '-')) ++it;
+                bool expdigit = false;
+                for (; it != end; ++it) {
+                    if ('0' <= *it && *it <= '9') {
+                        expdigit = true;
+                    } else {
+                        return false;
+                    }
+                }
+                return expdigit;
+            } else {
+                return false;
+            }
+        }
+        return dot;
+    }
+
+    static inline
+    Type parse_number(const char* v, size_t size, Value& value) {
+        // kInt or kDouble, and the value, as is_float_string() and strtoll/strtod give.
+        // v is terminated.
+        Type type;
+        if (parse_number_fast(v, size, type, value)) return type;
+        if (is_float_string(v, size)) {
+            value.d = std::strtod(v, nullptr);
+            return Type::kDouble;
+        }
+        value.i = std::strtoll(v, nullptr, 10);
+        return Type::kInt;
+    }
+
+    static inline
+    bool parse_number_fast(const char* v, size_t size, Type& type, Value& value) {
+        // one pass for the usual forms ("-12", "0.25", "1.5E-05"): up to 18 digits,
+        // and exact as double (clinger's fast path). false for the others.
+        static const double pow10[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+        };
+        auto p = v;
+        auto end = v + size;
+        bool neg = false;
+        if (p != end && (*p == '+' || *p == '-')) {
+            neg = *p == '-';
+            ++p;
+        }
+        uint64_t mant = 0;
+        int nsig = 0;
+        int exp10 = 0;
+        bool digit = false;
+        for (; p != end && static_cast<unsigned>(*p - '0') <= 9; ++p) {
+            digit = true;
+            if (mant == 0 && *p == '0') continue;
+            if (++nsig > 18) return false;
+            mant = mant * 10 + (*p - '0');
+        }
+        if (p == end) {
+            if (!digit) return false;
+            type = Type::kInt;
+            value.i = neg ? -static_cast<int64_t>(mant) : static_cast<int64_t>(mant);
+            return true;
+        }
+        if (*p == '.') {
+            for (++p; p != end && static_cast<unsigned>(*p - '0') <= 9; ++p) {
+                digit = true;
+                exp10--;
+                if (mant == 0 && *p == '0') continue;
+                if (++nsig > 18) return false;
+                mant = mant * 10 + (*p - '0');
+            }
+        }
+        if (p != end && (*p == 'E' || *p == 'e')) {
+            ++p;
+            bool exp_neg = false;
+            if (p != end && (*p == '+' || *p == '-')) {
+                exp_neg = *p == '-';
+                ++p;
+            }
+            int e = 0;
+            bool exp_digit = false;
+            for (; p != end && static_cast<unsigned>(*p - '0') <= 9; ++p) {
+                exp_digit = true;
+                if (e < 10000) e = e * 10 + (*p - '0');
+            }
+            if (!exp_digit) return false;
+            exp10 += exp_neg ? -e : e;
+        }
+        if (p != end || !digit) return false;
+        if (mant > (uint64_t(1) << 53) || exp10 < -22 || 22 < exp10) return false;
+        double d = static_cast<double>(mant);
+        d = exp10 < 0 ? d / pow10[-exp10] : d * pow10[exp10];
+        type = Type::kDouble;
+        value.d = neg ? -d : d;
+        return true;
+    }
+
+    inline
+    const char* c_str() {
+        // raw text, or the shared string. no copy.
+        if (text != nullptr) return text;
+        if (shared_string != nullptr) return shared_string->at(shared_string_index).c_str();
+        return "";
+    }
+
+    inline
+    std::string type_name() {
+        // for error.
+        switch (type) {
+            case (Type::kEmpty): return "empty";
+            case (Type::kString): return "string";
+            case (Type::kInt): return "int";
+            case (Type::kDouble): return "double";
+            case (Type::kDateTime): return "datetime";
+            case (Type::kBool): return "bool";
+        }
+        return "error";
+    }
+
+    inline
+    std::string cellname() {
+        std::string name;
         int ncol = col + 1;
         while (ncol > 0) {
             if (ncol % 26 == 0) {
@@ -324,219 +1163,1555 @@ struct Cell {
     }
 
     inline
-    int64_t as_int() {
-        try {
-            return std::stoll(v);
-        } catch (std::invalid_argument& exc) {
-            return 0;
-        }
-    }
+    int64_t as_int() {
+        switch (type) {
+            case (Type::kInt):
+            case (Type::kBool): return value.i;
+            case (Type::kDouble):
+            case (Type::kDateTime): return static_cast<int64_t>(value.d);
+            case (Type::kString): return std::strtoll(c_str(), nullptr, 10);
+            default: return 0;
+        }
+    }
+
+    inline
+    bool as_bool() {
+        if (type == Type::kBool) return value.i != 0;
+        auto v = c_str();
+        return v[0] != '\0' && std::strcmp(v, "0") != 0;
+    }
+
+    inline
+    double as_double() {
+        switch (type) {
+            case (Type::kInt):
+            case (Type::kBool): return static_cast<double>(value.i);
+            case (Type::kDouble):
+            case (Type::kDateTime): return value.d;
+            case (Type::kString): return std::strtod(c_str(), nullptr);
+            default: return 0.0;
+        }
+    }
+
+    inline
+    int64_t as_time64(int tz_seconds = 0) {
+        // xldate is double.
+        //   int-part: 1899-12-30 based days.
+        //   frac-part: time seconds / (24*60*60).
+        //   does not contain timezone info.
+        auto xldatetime = as_double();
+        int64_t xldays = xldatetime;
+        double seconds = (xldatetime - xldays) * 86400.0;
+        if (seconds == 86400.0) {
+            seconds = 0.0;
+            xldays += 1;
+        }
+        if (seconds > 0.1) {
+            seconds += 0.5;
+        } else if (seconds < -0.1) {
+            seconds -= 0.5;
+        }
+        // (1970-1-1) - (1899-12-30) = 25569 days.
+        return (xldays - 25569) * 86400 + seconds - tz_seconds;
+    }
+
+    inline
+    time_t as_time(int tz_seconds = 0) {
+        return as_time64(tz_seconds);
+    }
+
+    inline
+    std::string as_str() {
+        if (text != nullptr) return text;
+        if (shared_string != nullptr) return shared_string->at(shared_string_index);
+        return std::string();
+    }
+};
+
+struct ColumnarCells {
+    // cells of a mapped snapshot. k = colx * nrows + slot.
+    // texts are offsets of nul-terminated strings in pool.
+    const uint8_t* types;
+    const Cell::Value* values;
+    const uint32_t* texts;
+    const char* pool;
+};
+
+struct CellTable {
+    // typed cells in row-major arrays (nrows x ncols).
+    //   types_:  Cell::Type, with kArenaText flag.
+    //   values_: int64/double payload.
+    //   texts_:  shared string index, or offset in the row's arena (raw <v> text).
+    // sparse layout keeps only present cells, sorted by column, per row.
+    static const uint8_t kArenaText = 0x80;
+
+    struct Entry {
+        int colx;
+        uint8_t type;
+        uint32_t text;
+        Cell::Value value;
+    };
+
+    std::shared_ptr<SharedStrings> shared_string;
+    std::shared_ptr<StyleSheet> style_sheet;
+    int nrows_ = 0;
+    int ncols_ = 0;
+    bool sparse_ = false;
+    std::vector<uint8_t> types_;
+    std::vector<Cell::Value> values_;
+    std::vector<uint32_t> texts_;
+    std::vector<std::vector<Entry>> entries_;
+    std::vector<std::string> arenas_;
+    // column projection. decode_row skips other columns.
+    bool projected_ = false;
+    std::vector<uint8_t> columns_;
+    // read-only view of a snapshot, instead of the arrays.
+    bool mapped_ = false;
+    ColumnarCells columnar_;
+
+    CellTable() = default;
+
+    inline
+    CellTable(std::shared_ptr<SharedStrings> shared_string_,
+              std::shared_ptr<StyleSheet> style_sheet_)
+            : shared_string(shared_string_),
+              style_sheet(style_sheet_) {}
+
+    inline int nrows() { return nrows_; }
+    inline int ncols() { return ncols_; }
+
+    inline
+    size_t memory_size() {
+        // approximate. a mapped table is in the page cache, not here.
+        size_t size = types_.size() + values_.size() * sizeof(Cell::Value) +
+                      texts_.size() * sizeof(uint32_t);
+        for (auto& row : entries_) size += row.capacity() * sizeof(Entry);
+        for (auto& arena : arenas_) size += arena.capacity();
+        return size;
+    }
+
+    inline
+    void resize(int nrows, int ncols, bool sparse = false) {
+        nrows_ = nrows;
+        ncols_ = ncols;
+        sparse_ = sparse;
+        size_t size = sparse ? 0 : static_cast<size_t>(nrows) * ncols;
+        types_.assign(size, static_cast<uint8_t>(Cell::Type::kEmpty));
+        values_.assign(size, Cell::Value{0});
+        texts_.assign(size, 0);
+        entries_.assign(sparse ? nrows : 0, std::vector<Entry>());
+        arenas_.assign(nrows, std::string());
+    }
+
+    inline
+    void map(int nrows, int ncols, const ColumnarCells& columnar) {
+        nrows_ = nrows;
+        ncols_ = ncols;
+        mapped_ = true;
+        columnar_ = columnar;
+    }
+
+    inline
+    void project(const std::vector<int>& columns) {
+        // columns: 0-index. -1 is ignored.
+        columns_.clear();
+        for (int colx : columns) {
+            if (colx < 0) continue;
+            if (columns_.size() <= static_cast<size_t>(colx)) columns_.resize(colx + 1, 0);
+            columns_[colx] = 1;
+        }
+        projected_ = true;
+    }
+
+    inline
+    bool is_projected(int colx) {
+        if (!projected_) return true;
+        return static_cast<size_t>(colx) < columns_.size() && columns_[colx] != 0;
+    }
+
+    inline
+    void clear_row(int slot) {
+        arenas_[slot].clear();
+        if (sparse_) {
+            entries_[slot].clear();
+            return;
+        }
+        auto it = types_.begin() + static_cast<size_t>(slot) * ncols_;
+        std::fill(it, it + ncols_, static_cast<uint8_t>(Cell::Type::kEmpty));
+    }
+
+    inline
+    Entry& entry(int slot, int colx) {
+        // cells mostly arrive in column order.
+        auto& row = entries_[slot];
+        if (row.empty() || row.back().colx < colx) {
+            row.push_back(Entry{colx, Cell::Type::kEmpty, 0, Cell::Value{0}});
+            return row.back();
+        }
+        auto it = std::lower_bound(row.begin(), row.end(), colx,
+                                   [](const Entry& e, int x) { return e.colx < x; });
+        if (it == row.end() || it->colx != colx) {
+            it = row.insert(it, Entry{colx, Cell::Type::kEmpty, 0, Cell::Value{0}});
+        }
+        return *it;
+    }
+
+    inline
+    void set(int slot, int colx, const std::string& v, const std::string& t, int s) {
+        set(slot, colx, v.data(), v.size(), t.data(), t.size(), s);
+    }
+
+    inline
+    void set(int slot, int colx, const char* v, size_t v_size,
+             const char* t, size_t t_size, int s) {
+        // v, t: <v> text and t attribute, not terminated.
+        if (sparse_) {
+            auto& e = entry(slot, colx);
+            set(slot, v, v_size, t, t_size, s, e.type, e.value, e.text);
+        } else {
+            size_t k = static_cast<size_t>(slot) * ncols_ + colx;
+            set(slot, v, v_size, t, t_size, s, types_[k], values_[k], texts_[k]);
+        }
+    }
+
+    inline
+    void set(int slot, const char* v, size_t v_size, const char* t, size_t t_size, int s,
+             uint8_t& type_, Cell::Value& value, uint32_t& text) {
+        using Type = Cell::Type;
+        if (v_size == 0) {
+            type_ = Type::kEmpty;
+            return;
+        }
+        if (t_size == 1 && t[0] == 's') {
+            if (shared_string.get() == nullptr) {
+                throw Exception("invalid shared_string: nullptr");
+            }
+            // the id is checked by SharedStrings::at(). the table may be not loaded yet.
+            int n;
+            int64_t i = sheetdata::parse_uint(v, v_size, n) ? n : std::stoll(std::string(v, v_size));
+            if (i < 0 || i > std::numeric_limits<uint32_t>::max()) {
+                throw Exception("invalid shared_string: invalid id=", i);
+            }
+            type_ = Type::kString;
+            text = i;
+            return;
+        }
+        auto& arena = arenas_[slot];
+        text = arena.size();
+        arena.append(v, v_size);
+        arena.push_back('\0');
+        const char* str = arena.data() + text;
+        Type type;
+        if (t_size == 9 && std::memcmp(t, "inlineStr", 9) == 0) {
+            // v is the string itself (csv text fields).
+            type_ = Type::kString | kArenaText;
+            return;
+        }
+        if (t_size == 1 && t[0] == 'b') {
+            type = Type::kBool;
+            value.i = std::strtoll(str, nullptr, 10);
+        } else if (s > 0 && style_sheet->is_date_format(s)) {
+            type = Type::kDateTime;
+            Type parsed;
+            if (!Cell::parse_number_fast(str, v_size, parsed, value)) {
+                value.d = std::strtod(str, nullptr);
+            } else if (parsed == Type::kInt) {
+                value.d = (value.i == 0 && str[0] == '-') ? -0.0 : static_cast<double>(value.i);
+            }
+        } else {
+            type = Cell::parse_number(str, v_size, value);
+        }
+        type_ = type | kArenaText;
+    }
+
+    inline
+    Cell cell(int slot, int rowx, int colx) {
+        // rowx: sheet row of the slot, for cellname.
+        Cell cell(rowx, colx);
+        if (slot < 0 || nrows_ <= slot) return cell;
+        if (colx < 0 || ncols_ <= colx) return cell;
+        uint8_t tag;
+        uint32_t text;
+        if (mapped_) {
+            size_t k = static_cast<size_t>(colx) * nrows_ + slot;
+            cell.type = static_cast<Cell::Type>(columnar_.types[k]);
+            if (cell.type == Cell::Type::kEmpty) return cell;
+            cell.value = columnar_.values[k];
+            cell.text = columnar_.pool + columnar_.texts[k];
+            return cell;
+        }
+        if (sparse_) {
+            auto& row = entries_[slot];
+            auto it = std::lower_bound(row.begin(), row.end(), colx,
+                                       [](const Entry& e, int x) { return e.colx < x; });
+            if (it == row.end() || it->colx != colx) return cell;
+            tag = it->type;
+            cell.value = it->value;
+            text = it->text;
+        } else {
+            size_t k = static_cast<size_t>(slot) * ncols_ + colx;
+            tag = types_[k];
+            cell.value = values_[k];
+            text = texts_[k];
+        }
+        cell.type = static_cast<Cell::Type>(tag & ~kArenaText);
+        if (cell.type == Cell::Type::kEmpty) return cell;
+        if (tag & kArenaText) {
+            cell.text = arenas_[slot].c_str() + text;
+        } else {
+            cell.shared_string = shared_string.get();
+            cell.shared_string_index = text;
+        }
+        return cell;
+    }
+};
+
+struct Sheet {
+    std::string rid;
+    std::string name;
+    std::string demension;
+    std::unique_ptr<pugi::xml_document> doc;
+    std::shared_ptr<SharedStrings> shared_string;
+    std::shared_ptr<StyleSheet> style_sheet;
+
+    // raw entry. rows are decoded from it, unless it fell back to doc.
+    std::shared_ptr<ZipReader> archive;
+    std::string owned_;
+    const char* source_ = nullptr;
+    size_t source_size_ = 0;
+    // what a row of source_ is: <row> xml, BIFF12 records of xlsb, or a csv/tsv record.
+    enum Format : uint8_t { kXml, kBinary, kCsv };
+    Format format_ = kXml;
+    char delimiter_ = ',';  // csv
+    std::shared_ptr<MappedFile> file_;  // csv
+    std::shared_ptr<MappedFile> snapshot_;  // cells are mapped from it. see Snapshot.
+
+    // cached. a slot is a present <row>, in row order.
+    // the size comes from the rows and cells present, not from <dimension>.
+    struct RowRef {
+        int rowx;
+        pugi::xml_node node;  // doc
+        const char* begin;    // source_
+        const char* end;
+    };
+    std::vector<RowRef> row_refs_;
+    std::vector<int> row_indexes_;   // rowx of each slot.
+    std::vector<int> slot_by_rowx_;  // -1: no <row>. empty if rows are sparse.
+    int nrows_ = -1;
+    int ncols_ = -1;
+    CellTable table_;
+    // per slot: kRowPending -> kRowDecoding -> kRowDecoded.
+    // table_ row is published by the release store of kRowDecoded.
+    enum : uint8_t { kRowPending, kRowDecoding, kRowDecoded };
+    std::unique_ptr<std::atomic<uint8_t>[]> row_states_;
+    int nrow_nodes_ = 0;
+    std::atomic<int> ndecoded_rows_;
+    // eager preload. slots are claimed by chunks.
+    static const int preload_chunk_rows = 512;
+    // spreadsheet limits.
+    static const int max_rows = 1048576;
+    static const int max_cols = 16384;
+    std::atomic<int> next_chunk_;
+    std::atomic<bool> preloading_;
+    std::atomic<bool> preloaded;
+
+    Sheet() = default;
+
+    inline
+    Sheet(std::string rid_, std::string name_)
+            : rid(rid_), name(name_),
+              ndecoded_rows_(0),
+              next_chunk_(0),
+              preloading_(false),
+              preloaded(false) {
+        // empty. see map().
+    }
+
+    inline
+    Sheet(std::string rid_, std::string name_,
+          std::unique_ptr<pugi::xml_document> doc_,
+          std::shared_ptr<SharedStrings> shared_string_,
+          std::shared_ptr<StyleSheet> style_sheet_)
+            : rid(rid_), name(name_),
+              doc(std::move(doc_)),
+              shared_string(shared_string_),
+              style_sheet(style_sheet_),
+              table_(shared_string_, style_sheet_),
+              ndecoded_rows_(0),
+              next_chunk_(0),
+              preloading_(false),
+              preloaded(false) {
+        std::vector<RowRef> rows;
+        size_t ncells = 0;
+        index_doc(rows, ncells);
+        build(rows, ncells);
+    }
+
+    inline
+    Sheet(std::string rid_, std::string name_,
+          std::shared_ptr<ZipReader> archive_, int index,
+          std::shared_ptr<SharedStrings> shared_string_,
+          std::shared_ptr<StyleSheet> style_sheet_)
+            : rid(rid_), name(name_),
+              shared_string(shared_string_),
+              style_sheet(style_sheet_),
+              table_(shared_string_, style_sheet_),
+              ndecoded_rows_(0),
+              next_chunk_(0),
+              preloading_(false),
+              preloaded(false) {
+        // stored entries are read from the mapping, without a copy.
+        auto size = archive_->entry(index).size;
+        if (auto view = archive_->view(index)) {
+            archive = archive_;
+            source_ = view;
+        } else {
+            owned_.resize(size);
+            if (size > 0) archive_->read_entry(index, &owned_[0], size);
+            source_ = owned_.data();
+        }
+        source_size_ = size;
+        auto& entry_name = archive_->entry(index).name;
+        if (entry_name.size() > 4 && entry_name.compare(entry_name.size() - 4, 4, ".bin") == 0) {
+            format_ = kBinary;
+        }
+        init_source();
+    }
+
+    inline
+    Sheet(std::string rid_, std::string name_,
+          std::string source,
+          std::shared_ptr<SharedStrings> shared_string_,
+          std::shared_ptr<StyleSheet> style_sheet_)
+            : rid(rid_), name(name_),
+              shared_string(shared_string_),
+              style_sheet(style_sheet_),
+              owned_(std::move(source)),
+              source_(owned_.data()),
+              source_size_(owned_.size()),
+              table_(shared_string_, style_sheet_),
+              ndecoded_rows_(0),
+              next_chunk_(0),
+              preloading_(false),
+              preloaded(false) {
+        init_source();
+    }
+
+    inline
+    Sheet(std::string name_, std::shared_ptr<MappedFile> file, char delimiter)
+            : name(name_),
+              format_(kCsv),
+              delimiter_(delimiter),
+              file_(file),
+              ndecoded_rows_(0),
+              next_chunk_(0),
+              preloading_(false),
+              preloaded(false) {
+        // csv/tsv. a line is a row, a field is a cell. no styles, no shared strings.
+        source_ = file->data;
+        source_size_ = file->size;
+        std::vector<RowRef> rows;
+        size_t ncells = 0;
+        index_csv(rows, ncells);
+        build(rows, ncells);
+    }
+
+    inline
+    void init_source() {
+        // sheetData is tokenized by scan_row. anything unusual here is left to pugixml.
+        std::vector<RowRef> rows;
+        size_t ncells = 0;
+        if (format_ == kBinary) {
+            index_records(rows, ncells);
+        } else if (!index_source(rows, ncells)) {
+            logv("sheet: ", name, " pugixml fallback");
+            rows.clear();
+            ncells = 0;
+            doc.reset(new pugi::xml_document());
+            auto result = doc->load_buffer(source_, source_size_,
+                                           pugi::parse_default, pugi::encoding_utf8);
+            if (!result) {
+                throw Exception("sheet=", name, ": parse error!! ", result.description());
+            }
+            release_source();
+            index_doc(rows, ncells);
+        }
+        build(rows, ncells);
+    }
+
+    inline
+    bool index_source(std::vector<RowRef>& rows, size_t& ncells) {
+        namespace sd = sheetdata;
+        auto p = source_;
+        auto end = source_ + source_size_;
+        // <dimension> is informational only.
+        for (;;) {
+            p = sd::find(p, end, '<');
+            if (p == end) return false;
+            ++p;
+            if (sd::is_tag(p, end, "dimension", 9)) {
+                p += 9;
+                sd::Attr attr;
+                bool empty;
+                while (sd::next_attr(p, end, attr, empty) == 1) {
+                    if (attr.name_size == 3 && std::memcmp(attr.name, "ref", 3) == 0) {
+                        demension.assign(attr.value, attr.value_size);
+                    }
+                }
+            } else if (sd::is_tag(p, end, "sheetData", 9)) {
+                p += 9;
+                break;
+            }
+        }
+        sd::Attr attr;
+        bool empty;
+        int r;
+        while ((r = sd::next_attr(p, end, attr, empty)) == 1) {}
+        if (r < 0) return false;
+        if (empty) return true;
+        for (;;) {
+            p = sd::find(p, end, '<');
+            if (p == end) return false;
+            if (end - p >= 12 && std::memcmp(p, "</sheetData>", 12) == 0) return true;
+            RowRef row;
+            int width;
+            if (!index_row(p, end, row, width, ncells)) return false;
+            ncols_ = std::max(ncols_, width);
+            rows.push_back(row);
+        }
+    }
+
+    inline
+    void index_records(std::vector<RowRef>& rows, size_t& ncells) {
+        // a row is its BrtRowHdr and the cell records up to the next one.
+        auto p = source_;
+        auto end = source_ + source_size_;
+        xlsb::Record record;
+        bool sheet_data = false;
+        const char* at = p;
+        int r;
+        ncols_ = 0;
+        for (; (r = xlsb::next_record(p, end, record)) == 1; at = p) {
+            if (!sheet_data) {
+                if (record.type == xlsb::kWsDim && record.size >= 16) {
+                    // rwFirst, rwLast, colFirst, colLast.
+                    auto& d = record.data;
+                    demension = Cell(xlsb::le32(d), xlsb::le32(d + 8)).cellname() + ":" +
+                                Cell(xlsb::le32(d + 4), xlsb::le32(d + 12)).cellname();
+                } else if (record.type == xlsb::kBeginSheetData) {
+                    sheet_data = true;
+                }
+                continue;
+            }
+            if (record.type == xlsb::kEndSheetData) break;
+            if (record.type == xlsb::kRowHdr) {
+                if (record.size < 4) throw Exception("sheet=", name, ": bad BrtRowHdr.");
+                uint32_t rowx = xlsb::le32(record.data);
+                if (max_rows <= rowx) {
+                    throw Exception("invalid row: ", rowx);
+                }
+                if (!rows.empty()) rows.back().end = at;
+                rows.push_back(RowRef{static_cast<int>(rowx), pugi::xml_node(), at, nullptr});
+            } else if (xlsb::is_cell(record.type)) {
+                if (rows.empty() || record.size < 4) {
+                    throw Exception("sheet=", name, ": bad cell record.");
+                }
+                uint32_t colx = xlsb::le32(record.data);
+                if (max_cols <= colx) {
+                    throw Exception("invalid col: ", colx);
+                }
+                ncols_ = std::max(ncols_, static_cast<int>(colx) + 1);
+                ncells++;
+            }
+        }
+        if (r < 0) throw Exception("sheet=", name, ": unexpected eof.");
+        if (!rows.empty()) rows.back().end = at;
+    }
+
+    inline
+    void index_csv(std::vector<RowRef>& rows, size_t& ncells) {
+        // empty lines have no row.
+        auto p = source_;
+        auto end = source_ + source_size_;
+        if (end - p >= 3 && std::memcmp(p, "\xef\xbb\xbf", 3) == 0) p += 3;  // BOM
+        ncols_ = 0;
+        for (int rowx = 0; p < end; ++rowx) {
+            if (max_rows <= rowx) {
+                throw Exception("invalid row: ", rowx);
+            }
+            int nfields;
+            auto q = csvdata::scan_record(p, end, delimiter_, nfields);
+            if (!csvdata::is_blank(p, q)) {
+                if (max_cols < nfields) {
+                    throw Exception("invalid col: ", nfields - 1);
+                }
+                rows.push_back(RowRef{rowx, pugi::xml_node(), p, q});
+                ncols_ = std::max(ncols_, nfields);
+                ncells += nfields;
+            }
+            p = q == end ? end : q + 1;
+        }
+    }
+
+    static inline
+    bool index_row(const char*& p, const char* end, RowRef& row, int& width, size_t& ncells) {
+        // p: at "<row". row is [p, after "</row>"), p moves there.
+        // width: colx + 1 of the last cell.
+        namespace sd = sheetdata;
+        if (!sd::is_tag(p + 1, end, "row", 3)) return false;
+        row.begin = p;
+        p += 4;
+        sd::Attr attr;
+        bool empty;
+        int r;
+        int rowx = -1;
+        while ((r = sd::next_attr(p, end, attr, empty)) == 1) {
+            if (attr.name_size == 1 && attr.name[0] == 'r') {
+                int n;
+                if (!sd::parse_uint(attr.value, attr.value_size, n)) return false;
+                rowx = n - 1;
+            }
+        }
+        if (r < 0 || rowx == -1) return false;
+        if (rowx < 0 || max_rows <= rowx) {
+            throw Exception("invalid row: ", rowx);
+        }
+        row.rowx = rowx;
+        width = 0;
+        if (empty) {
+            row.end = p;
+            return true;
+        }
+        const char* last = nullptr;
+        for (;;) {
+            p = sd::find(p, end, '<');
+            if (p + 1 >= end) return false;
+            ++p;
+            char c = *p;
+            if (c == '!' || c == '?') return false;
+            if (c == 'c' && sd::is_tag(p, end, "c", 1)) {
+                last = p + 1;
+                ncells++;
+            } else if (c == '/' && sd::is_tag(p + 1, end, "row", 3)) {
+                p = sd::find(p, end, '>');
+                if (p == end) return false;
+                row.end = ++p;
+                break;
+            }
+        }
+        if (last != nullptr) {
+            while ((r = sd::next_attr(last, end, attr, empty)) == 1) {
+                if (attr.name_size == 1 && attr.name[0] == 'r') break;
+            }
+            int rowx_, colx;
+            if (r != 1 || !sd::parse_ref(attr.value, attr.value_size, rowx_, colx)) return false;
+            if (colx < 0 || max_cols <= colx) {
+                throw Exception("invalid col: ", colx);
+            }
+            width = colx + 1;
+        }
+        return true;
+    }
+
+    inline
+    void index_doc(std::vector<RowRef>& rows, size_t& ncells) {
+        auto sheet = doc->child("worksheet");
+        // may be missing, or bogus (A1:XFD1048576 after a stray format edit).
+        demension = sheet.child("dimension").attribute("ref").as_string();
+        ncols_ = 0;
+        for (auto& row : sheet.child("sheetData").children("row")) {
+            int r = row.attribute("r").as_int() - 1;
+            if (r < 0 || max_rows <= r) {
+                throw Exception("invalid row: ", r);
+            }
+            rows.push_back(RowRef{r, row, nullptr, nullptr});
+            // cells are in column order. the last one is the widest.
+            pugi::xml_node last;
+            for (auto c = row.child("c"); c; c = c.next_sibling("c")) {
+                last = c;
+                ncells++;
+            }
+            if (last) {
+                int colx = std::get<1>(parse_cellname(last.attribute("r").as_string()));
+                if (colx < 0 || max_cols <= colx) {
+                    throw Exception("invalid col: ", colx);
+                }
+                ncols_ = std::max(ncols_, colx + 1);
+            }
+        }
+    }
+
+    inline
+    void build(std::vector<RowRef>& rows, size_t ncells) {
+        bool sorted = true;
+        for (size_t i = 1; i < rows.size(); ++i) {
+            if (rows[i - 1].rowx >= rows[i].rowx) sorted = false;
+        }
+        if (!sorted) {
+            // the last <row> of the same r wins.
+            std::stable_sort(rows.begin(), rows.end(),
+                             [](const RowRef& a, const RowRef& b) { return a.rowx < b.rowx; });
+            std::vector<RowRef> unique;
+            for (auto& row : rows) {
+                if (!unique.empty() && unique.back().rowx == row.rowx) {
+                    unique.back() = row;
+                } else {
+                    unique.push_back(row);
+                }
+            }
+            rows.swap(unique);
+        }
+        for (auto& row : rows) row_indexes_.push_back(row.rowx);
+        row_refs_.swap(rows);
+        index_slots(ncells);
+        // dense arrays, unless most of them would be empty.
+        size_t dense_min_size = std::max<size_t>(ncells * 4, 64 * 1024);
+        bool sparse = static_cast<size_t>(nrow_nodes_) * ncols_ > dense_min_size;
+        table_.resize(nrow_nodes_, ncols_, sparse);
+        logv("sheet: ", name, " dimension: ", demension, " rows: ", nrow_nodes_, "/", nrows_,
+             " cols: ", ncols_, " cells: ", ncells, (sparse ? " (sparse)" : ""));
+        row_states_.reset(new std::atomic<uint8_t>[nrow_nodes_]);
+        for (int i = 0; i < nrow_nodes_; ++i) {
+            row_states_[i].store(kRowPending, std::memory_order_relaxed);
+        }
+        if (nrow_nodes_ == 0) release_doc();
+    }
+
+    inline
+    void index_slots(size_t ncells) {
+        // row_indexes_ is set. a rowx -> slot array, unless most of it would be empty.
+        nrow_nodes_ = row_indexes_.size();
+        nrows_ = row_indexes_.empty() ? 0 : row_indexes_.back() + 1;
+        size_t dense_min_size = std::max<size_t>(ncells * 4, 64 * 1024);
+        if (static_cast<size_t>(nrows_) <= nrow_nodes_ * 4 + dense_min_size) {
+            slot_by_rowx_.assign(nrows_, -1);
+            for (int i = 0; i < nrow_nodes_; ++i) slot_by_rowx_[row_indexes_[i]] = i;
+        }
+    }
+
+    inline
+    void map(std::shared_ptr<MappedFile> snapshot, std::vector<int> row_indexes, int ncols,
+             const ColumnarCells& columnar) {
+        // every row is decoded in the snapshot already.
+        snapshot_ = snapshot;
+        row_indexes_.swap(row_indexes);
+        ncols_ = ncols;
+        index_slots(static_cast<size_t>(row_indexes_.size()) * ncols);
+        table_.map(nrow_nodes_, ncols_, columnar);
+        row_states_.reset(new std::atomic<uint8_t>[nrow_nodes_]);
+        for (int i = 0; i < nrow_nodes_; ++i) {
+            row_states_[i].store(kRowDecoded, std::memory_order_relaxed);
+        }
+        ndecoded_rows_ = nrow_nodes_;
+        preloading_ = true;
+        preloaded = true;
+        logv("sheet: ", name, " snapshot: ", snapshot_->path, " rows: ", nrow_nodes_, "/", nrows_,
+             " cols: ", ncols_);
+    }
+
+    inline
+    int next_row(int rowx) {
+        // first rowx with a <row>, from rowx. nrows() if none.
+        auto it = std::lower_bound(row_indexes_.begin(), row_indexes_.end(), rowx);
+        return it == row_indexes_.end() ? nrows_ : *it;
+    }
+
+    inline
+    int slot(int rowx) {
+        // -1: no <row> for rowx.
+        if (rowx < 0 || nrows_ <= rowx) return -1;
+        if (!slot_by_rowx_.empty()) return slot_by_rowx_[rowx];
+        auto it = std::lower_bound(row_indexes_.begin(), row_indexes_.end(), rowx);
+        if (it == row_indexes_.end() || *it != rowx) return -1;
+        return it - row_indexes_.begin();
+    }
+
+    inline
+    int nrows() {
+        return nrows_;
+    }
+
+    inline
+    size_t memory_size() {
+        // approximate. decoded rows, and the entry while rows are pending.
+        return table_.memory_size() + owned_.size() + row_refs_.size() * sizeof(RowRef) +
+               (row_indexes_.size() + slot_by_rowx_.size()) * sizeof(int) + nrow_nodes_;
+    }
+
+    inline
+    int ncols() {
+        return ncols_;
+    }
+
+    inline
+    Cell cell(const std::string& cellname) {
+        int rowx, colx;
+        std::tie(rowx, colx) = parse_cellname(cellname);
+        return cell(rowx, colx);
+    }
+
+    inline
+    Cell cell(int rowx, int colx) {
+        // row, col: 0-index
+        auto nrowx = nrows();
+        auto ncolx = ncols();
+        if (rowx < 0 || nrowx <= rowx) return Cell(rowx, colx);
+        if (colx < 0 || ncolx <= colx) return Cell(rowx, colx);
+
+        int i = slot(rowx);
+        if (i < 0) return Cell(rowx, colx);
+        if (row_states_[i].load(std::memory_order_acquire) != kRowDecoded) {
+            decode(i);
+        }
+        return table_.cell(i, rowx, colx);
+    }
+
+    inline
+    void decode(int slot) {
+        // first caller decodes the row, others wait for it.
+        auto& state = row_states_[slot];
+        uint8_t expected = kRowPending;
+        if (state.compare_exchange_strong(expected, kRowDecoding, std::memory_order_acquire)) {
+            try {
+                auto& row = row_refs_[slot];
+                if (row.node) {
+                    decode_row(row.node, row.rowx, table_, slot);
+                } else if (format_ == kBinary) {
+                    decode_records(row.begin, row.end, row.rowx, table_, slot);
+                } else if (format_ == kCsv) {
+                    decode_csv(row.begin, row.end, delimiter_, table_, slot);
+                } else {
+                    decode_row(row.begin, row.end, row.rowx, table_, slot);
+                }
+            } catch (...) {
+                table_.clear_row(slot);
+                state.store(kRowPending, std::memory_order_release);
+                throw;
+            }
+            state.store(kRowDecoded, std::memory_order_release);
+            if (++ndecoded_rows_ == nrow_nodes_) release_doc();
+            return;
+        }
+        while (state.load(std::memory_order_acquire) != kRowDecoded) {
+            if (state.load(std::memory_order_relaxed) == kRowPending) {
+                // decoder failed. retry (and rethrow) here.
+                return decode(slot);
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    inline
+    void preload(int jobs) {
+        // decodes all rows now, on up to `jobs` threads (this one included).
+        // a second caller only helps with the remaining chunks.
+        if (preloaded.load()) return;
+        bool expected = false;
+        if (!preloading_.compare_exchange_strong(expected, true)) {
+            while (preload_chunk()) {}
+            return;
+        }
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        auto work = [&]() {
+            try {
+                while (preload_chunk()) {}
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+            }
+        };
+        int nchunks = (nrow_nodes_ + preload_chunk_rows - 1) / preload_chunk_rows;
+        std::vector<std::thread> threads;
+        for (int i = 1; i < jobs && i < nchunks; ++i) {
+            threads.emplace_back(work);
+        }
+        work();
+        for (auto& thread : threads) thread.join();
+        if (error) std::rethrow_exception(error);
+        preloaded = true;
+    }
+
+    inline
+    bool preload_chunk() {
+        // false: no chunk left.
+        int begin = next_chunk_++ * preload_chunk_rows;
+        if (begin >= nrow_nodes_) return false;
+        int end = std::min(nrow_nodes_, begin + preload_chunk_rows);
+        for (int j = begin; j < end; ++j) {
+            if (row_states_[j].load(std::memory_order_acquire) != kRowDecoded) decode(j);
+        }
+        return true;
+    }
+
+    inline
+    void project(const std::vector<int>& columns) {
+        // rows decoded after this keep only these columns.
+        // the sheet must not be shared with other readers.
+        table_.project(columns);
+    }
+
+    inline
+    void release_doc() {
+        // every row is in table_. the dom and the entry are no longer needed.
+        std::vector<RowRef>().swap(row_refs_);
+        doc.reset();
+        release_source();
+    }
+
+    inline
+    void release_source() {
+        std::string().swap(owned_);
+        archive.reset();
+        file_.reset();
+        source_ = nullptr;
+        source_size_ = 0;
+    }
+
+    static inline
+    void decode_row(const char* begin, const char* end, int rowx, CellTable& table, int slot) {
+        // [begin, end): "<row ...>...</row>".
+        if (scan_row(begin, end, rowx, table, slot)) return;
+        table.clear_row(slot);
+        pugi::xml_document row_doc;
+        auto result = row_doc.load_buffer(begin, end - begin,
+                                          pugi::parse_default, pugi::encoding_utf8);
+        if (!result) {
+            throw Exception("parse error!! row=", rowx + 1);
+        }
+        decode_row(row_doc.child("row"), rowx, table, slot);
+    }
+
+    static inline
+    bool scan_row(const char* p, const char* end, int rowx, CellTable& table, int slot) {
+        // fast path of decode_row. no dom, no allocation but the cell arena.
+        // false: something unusual. the caller decodes the row again with pugixml.
+        namespace sd = sheetdata;
+        sd::Attr attr;
+        bool empty;
+        int r;
+        p += 4;  // "<row"
+        while ((r = sd::next_attr(p, end, attr, empty)) == 1) {}
+        if (r < 0) return false;
+        if (empty) return true;
+        for (;;) {
+            p = sd::find(p, end, '<');
+            if (p + 1 >= end) return false;
+            ++p;
+            if (*p == '/') return sd::is_tag(p + 1, end, "row", 3);
+            if (!sd::is_tag(p, end, "c", 1)) return false;
+            p += 1;
+            const char* ref = nullptr;
+            size_t ref_size = 0;
+            const char* t = "";
+            size_t t_size = 0;
+            int s = 0;
+            while ((r = sd::next_attr(p, end, attr, empty)) == 1) {
+                if (attr.name_size != 1) continue;
+                if (attr.name[0] == 'r') {
+                    ref = attr.value;
+                    ref_size = attr.value_size;
+                } else if (attr.name[0] == 's') {
+                    if (!sd::parse_uint(attr.value, attr.value_size, s)) return false;
+                } else if (attr.name[0] == 't') {
+                    t = attr.value;
+                    t_size = attr.value_size;
+                }
+            }
+            int colx, rowx_;
+            if (r < 0 || !sd::parse_ref(ref, ref_size, rowx_, colx)) return false;
+            if (rowx_ != rowx) {
+                throw Exception("bad. r=", std::string(ref, ref_size), " row=", rowx,
+                                " parsed_row=", rowx_);
+            }
+            // children: <v>, and <f> which is skipped.
+            const char* v = nullptr;
+            size_t v_size = 0;
+            while (!empty) {
+                p = sd::find(p, end, '<');
+                if (p + 3 >= end) return false;
+                ++p;
+                if (p[0] == 'v' && p[1] == '>') {
+                    if (v != nullptr) return false;
+                    v = p + 2;
+                    p = sd::find(v, end, '<');
+                    if (end - p < 4 || std::memcmp(p, "</v>", 4) != 0) return false;
+                    v_size = p - v;
+                    int kind = sd::text_kind(v, v_size);
+                    if (kind < 0) return false;
+                    if (kind == 0) v_size = 0;
+                    p += 4;
+                } else if (sd::is_tag(p, end, "f", 1)) {
+                    p += 1;
+                    bool f_empty;
+                    while ((r = sd::next_attr(p, end, attr, f_empty)) == 1) {}
+                    if (r < 0) return false;
+                    if (!f_empty) {
+                        p = sd::find(p, end, '<');
+                        if (end - p < 4 || std::memcmp(p, "</f>", 4) != 0) return false;
+                        p += 4;
+                    }
+                } else if (p[0] == '/' && p[1] == 'c' && p[2] == '>') {
+                    p += 3;
+                    break;
+                } else {
+                    return false;
+                }
+            }
+            // out of the table, or not projected.
+            if (colx < 0 || table.ncols() <= colx) continue;
+            if (!table.is_projected(colx)) continue;
+            table.set(slot, colx, v, v_size, t, t_size, s);
+        }
+    }
+
+    static inline
+    void decode_records(const char* p, const char* end, int rowx, CellTable& table, int slot) {
+        // [p, end): BrtRowHdr and the cell records of the row.
+        xlsb::Record record;
+        std::string v;
+        const char* t;
+        int colx, s, r;
+        while ((r = xlsb::next_record(p, end, record)) == 1) {
+            if (!xlsb::is_cell(record.type)) continue;
+            if (!xlsb::read_cell(record, colx, s, v, t)) {
+                throw Exception("bad cell record. row=", rowx + 1);
+            }
+            // out of the table, or not projected.
+            if (colx < 0 || table.ncols() <= colx) continue;
+            if (!table.is_projected(colx)) continue;
+            table.set(slot, colx, v.data(), v.size(), t, std::strlen(t), s);
+        }
+        if (r < 0) throw Exception("parse error!! row=", rowx + 1);
+    }
+
+    static inline
+    void decode_csv(const char* p, const char* end, char delimiter, CellTable& table, int slot) {
+        // [p, end): a record without '\n'. numbers are typed as <v> of xml, others are text.
+        std::string buffer;
+        const char* v;
+        size_t v_size;
+        for (int colx = 0; p != nullptr && colx < table.ncols(); ++colx) {
+            p = csvdata::next_field(p, end, delimiter, buffer, v, v_size);
+            if (v_size == 0 || !table.is_projected(colx)) continue;
+            if (csvdata::is_number(v, v_size)) {
+                table.set(slot, colx, v, v_size, "", 0, 0);
+            } else {
+                table.set(slot, colx, v, v_size, "inlineStr", 9, 0);
+            }
+        }
+    }
+
+    static inline
+    void decode_row(pugi::xml_node row, int rowx, CellTable& table, int slot) {
+        for (auto& c : row.children("c")) {
+            std::string r = c.attribute("r").as_string();
+            int colx, rowx_;
+            std::tie(rowx_, colx) = parse_cellname(r);
+            if (rowx_ != rowx) {
+                throw Exception("bad. r=", r, " row=", rowx, " parsed_row=", rowx_);
+            }
+            // out of the table, or not projected.
+            if (colx < 0 || table.ncols() <= colx) continue;
+            if (!table.is_projected(colx)) continue;
+            std::string t = c.attribute("t").as_string();
+            auto s = c.attribute("s").as_int();
+            std::string v = c.child("v").text().as_string();
+            table.set(slot, colx, v, t, s);
+        }
+    }
+
+    static inline
+    std::tuple<int, int> parse_cellname(std::string r) {
+        size_t p = std::string::npos;
+        int colx = 0;
+        for (size_t i = 0; i < r.size(); ++i) {
+            uint8_t c = r[i];
+            if ('A' <= c && c <= 'Z') {
+                colx = colx * ('Z' - 'A' + 1) + (c - 'A' + 1);
+            } else if ('0' <= c && c <= '9') {
+                p = i;
+                break;
+            } else {
+                throw Exception("bad position char. row");
+            }
+        }
+        colx--;
+        if (p == std::string::npos) {
+            throw Exception("bad position char. col");
+        }
+        int rowx = std::stoi(r.substr(p)) - 1;
+        return std::make_tuple(rowx, colx);
+    }
+};
+
+
+struct RowCursor {
+    // forward-only row reader.
+    // reads sheetData from the decompression stream chunk by chunk,
+    // so only one row (and the shared strings) is kept in memory.
+    static const size_t chunk_size = 64 * 1024;
+
+    std::unique_ptr<ZipReader::Stream> stream;
+    std::shared_ptr<SharedStrings> shared_string;
+    std::shared_ptr<StyleSheet> style_sheet;
+
+    std::string buffer;
+    size_t pos = 0;
+    bool eof = false;
+    bool in_sheet_data = false;
+    bool finished = false;
+
+    int rowx_ = -1;
+    int stop_rowx_ = std::numeric_limits<int>::max();
+    CellTable table_;  // current row only.
+    std::unique_ptr<pugi::xml_document> row_doc;
+
+    inline
+    RowCursor(std::unique_ptr<ZipReader::Stream> stream_,
+              std::shared_ptr<SharedStrings> shared_string_,
+              std::shared_ptr<StyleSheet> style_sheet_)
+            : stream(std::move(stream_)),
+              shared_string(shared_string_),
+              style_sheet(style_sheet_),
+              table_(shared_string_, style_sheet_),
+              row_doc(new pugi::xml_document()) {}
+
+    RowCursor(RowCursor&&) = default;
 
     inline
-    bool as_bool() {
-        return v != "0" && !v.empty();
+    int row() {
+        return rowx_;
     }
 
     inline
-    double as_double() {
-        try {
-            return std::stod(v);
-        } catch (std::invalid_argument& exc) {
-            return 0.0;
-        }
+    int ncols() {
+        return table_.ncols();
     }
 
     inline
-    int64_t as_time64(int tz_seconds = 0) {
-        // xldate is double.
-        //   int-part: 1899-12-30 based days.
-        //   frac-part: time seconds / (24*60*60).
-        //   does not contain timezone info.
-        auto xldatetime = as_double();
-        int64_t xldays = xldatetime;
-        double seconds = (xldatetime - xldays) * 86400.0;
-        if (seconds == 86400.0) {
-            seconds = 0.0;
-            xldays += 1;
-        }
-        if (seconds > 0.1) {
-            seconds += 0.5;
-        } else if (seconds < -0.1) {
-            seconds -= 0.5;
-        }
-        // (1970-1-1) - (1899-12-30) = 25569 days.
-        return (xldays - 25569) * 86400 + seconds - tz_seconds;
+    Cell cell(int colx) {
+        // colx: 0-index, in current row. valid until next().
+        return table_.cell(0, rowx_, colx);
     }
 
     inline
-    time_t as_time(int tz_seconds = 0) {
-        return as_time64(tz_seconds);
+    CellTable& table() {
+        return table_;
     }
 
     inline
-    std::string as_str() {
-        return v;
+    void project(const std::vector<int>& columns) {
+        // following rows keep only these columns.
+        table_.project(columns);
     }
-};
 
-struct Sheet {
-    std::string rid;
-    std::string name;
-    std::string demension;
-    std::unique_ptr<pugi::xml_document> doc;
-    std::shared_ptr<std::vector<std::string>> shared_string;
-    std::shared_ptr<StyleSheet> style_sheet;
+    inline
+    bool next() {
+        return next_(-1);
+    }
 
-    // cached
-    std::vector<pugi::xml_node> row_nodes_;
-    int nrows_ = -1;
-    int ncols_ = -1;
-    std::vector<std::vector<Cell>> cells_;
-    std::unique_ptr<std::vector<std::mutex>> row_locks;
-    bool preloaded;
+    inline
+    bool skip_to(int rowx) {
+        // moves to the first row >= rowx. rows before it are not parsed.
+        return next_(rowx);
+    }
 
-    Cell ncell;
+    inline
+    void stop_at(int rowx) {
+        // rows >= rowx are not read. no more inflation after them.
+        stop_rowx_ = rowx;
+    }
 
-    Sheet() = default;
+    inline
+    bool next_(int min_rowx) {
+        for (;;) {
+            if (finished) return false;
+            if (pos >= chunk_size) {
+                buffer.erase(0, pos);
+                pos = 0;
+            }
+            if (!in_sheet_data) {
+                if (!seek_sheet_data()) {
+                    finished = true;
+                    return false;
+                }
+            }
+            if (read_row(min_rowx)) return true;
+        }
+    }
 
     inline
-    Sheet(std::string rid_, std::string name_,
-          std::unique_ptr<pugi::xml_document> doc_,
-          std::shared_ptr<std::vector<std::string>> shared_string_,
-          std::shared_ptr<StyleSheet> style_sheet_)
-            : rid(rid_), name(name_),
-              doc(std::move(doc_)),
-              shared_string(shared_string_),
-              style_sheet(style_sheet_),
-              preloaded(false) {
-        auto sheet = doc->child("worksheet");
-        auto dimension = sheet.child("dimension");
-        std::string dimension_ref = dimension.attribute("ref").as_string();
-        auto p = dimension_ref.find(':');
-        if (p == std::string::npos) {
-            throw Exception("invalid demension: ", dimension_ref);
-        }
-        int maxx, maxy;
-        std::tie(maxy, maxx) = parse_cellname(dimension_ref.substr(p+1));
-        nrows_ = maxy + 1;
-        ncols_ = maxx + 1;
-        // avoid realloc. (bad access)
-        cells_.resize(nrows_);
-        for (int j = 0; j < nrows_; ++j) {
-            cells_[j].reserve(ncols_);
-        }
-        row_locks = std::unique_ptr<std::vector<std::mutex>>(new std::vector<std::mutex>(nrows_));
-        // for random access xmldoc;
-        row_nodes_.resize(nrows_);
-        for (auto& row : sheet.child("sheetData").children("row")) {
-            int r = row.attribute("r").as_int() - 1;
-            if (r < 0 || nrows_ <= r) {
-                throw Exception("invalid row: ", r);
+    bool read_row(int min_rowx) {
+        // false: the row is skipped, or sheetData is finished.
+        auto tag = find_('<', pos);
+        if (tag == std::string::npos || !fill_to(tag + 5)) {
+            throw Exception("unexpected eof in sheetData.");
+        }
+        if (buffer.compare(tag, 5, "</she") == 0) {
+            finished = true;
+            return false;
+        }
+        if (buffer.compare(tag, 4, "<row") != 0 || !is_tag_end(buffer[tag + 4])) {
+            throw Exception("unexpected element in sheetData.");
+        }
+        auto gt = find_('>', tag);
+        if (gt == std::string::npos) {
+            throw Exception("unexpected eof in row.");
+        }
+        int rowx = row_index(tag, gt);
+        if (rowx >= stop_rowx_) {
+            finished = true;
+            return false;
+        }
+        size_t end;
+        if (buffer[gt - 1] == '/') {
+            end = gt + 1;
+        } else {
+            end = find_("</row>", gt);
+            if (end == std::string::npos) {
+                throw Exception("unexpected eof in row.");
             }
-            row_nodes_[r] = row;
+            end += 6;
+        }
+        if (rowx < min_rowx) {
+            pos = end;
+            rowx_ = rowx;
+            return false;
         }
+        auto begin = buffer.data() + tag;
+        auto row_end = buffer.data() + end;
+        Sheet::RowRef row;
+        auto p = begin;
+        int ncols;
+        size_t ncells = 0;
+        if (Sheet::index_row(p, row_end, row, ncols, ncells)) {
+            clear_row(ncols);
+            Sheet::decode_row(begin, row_end, rowx, table_, 0);
+            pos = end;
+            rowx_ = rowx;
+            return true;
+        }
+        // unusual row. pugixml only.
+        auto result = row_doc->load_buffer(begin, end - tag,
+                                           pugi::parse_default, pugi::encoding_utf8);
+        if (!result) {
+            throw Exception("parse error!! row=", rowx + 1);
+        }
+        pos = end;
+        auto row_node = row_doc->child("row");
+        rowx_ = rowx;
+        ncols = 0;
+        for (auto c = row_node.last_child(); c; c = c.previous_sibling()) {
+            if (std::strcmp(c.name(), "c") != 0) continue;
+            int colx = std::get<1>(Sheet::parse_cellname(c.attribute("r").as_string()));
+            if (ncols <= colx) ncols = colx + 1;
+            break;
+        }
+        clear_row(ncols);
+        Sheet::decode_row(row_node, rowx_, table_, 0);
+        return true;
     }
 
     inline
-    int nrows() {
-        return nrows_;
+    void clear_row(int ncols) {
+        // as wide as the widest row so far. <dimension> may be bogus.
+        if (table_.ncols() < ncols) {
+            table_.resize(1, ncols);
+        } else {
+            table_.clear_row(0);
+        }
     }
 
     inline
-    int ncols() {
-        return ncols_;
+    bool seek_sheet_data() {
+        auto p = find_("<sheetData", pos);
+        if (p == std::string::npos) return false;
+        auto gt = find_('>', p);
+        if (gt == std::string::npos) return false;
+        pos = gt + 1;
+        in_sheet_data = true;
+        // <sheetData/>
+        return buffer[gt - 1] != '/';
     }
 
     inline
-    Cell& cell(const std::string& cellname) {
-        int rowx, colx;
-        std::tie(rowx, colx) = parse_cellname(cellname);
-        return cell(rowx, colx);
+    int row_index(size_t tag, size_t gt) {
+        // r attribute in <row ...>, without parsing the row.
+        for (auto p = tag + 4; p < gt; ++p) {
+            p = buffer.find("r=", p);
+            if (p == std::string::npos || p >= gt) break;
+            if (!is_tag_end(buffer[p - 1])) continue;
+            return std::atoi(&buffer[p + 3]) - 1;
+        }
+        return rowx_ + 1;
+    }
+
+    static inline
+    bool is_tag_end(char c) {
+        return c == '>' || c == '/' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    template<class N>
+    size_t find_(const N& needle, size_t from) {
+        for (;;) {
+            auto p = buffer.find(needle, from);
+            if (p != std::string::npos) return p;
+            if (eof) return std::string::npos;
+            // needle may straddle the chunk boundary.
+            if (buffer.size() > from + 16) from = buffer.size() - 16;
+            fill_();
+        }
     }
 
     inline
-    Cell& cell(int rowx, int colx) {
-        // row, col: 0-index
-        auto nrowx = nrows();
-        auto ncolx = ncols();
-        if (rowx < 0 || nrowx <= rowx) return ncell;
-        if (colx < 0 || ncolx <= colx) return ncell;
+    bool fill_to(size_t size) {
+        while (buffer.size() < size) {
+            if (eof) return false;
+            fill_();
+        }
+        return true;
+    }
+
+    inline
+    void fill_() {
+        auto size = buffer.size();
+        buffer.resize(size + chunk_size);
+        auto n = stream->read(&buffer[size], chunk_size);
+        buffer.resize(size + n);
+        if (n < chunk_size) eof = true;
+    }
+};
+
 
-        std::lock_guard<std::mutex> lock((*row_locks)[rowx]);
-        if (colx < cells_[rowx].size()) {
-            return cells_[rowx][colx];
+struct Snapshot {
+    // a decoded sheet on disk (snapshot_dir()), mapped by later runs instead of decoding.
+    // keyed by the workbook path, size, mtime and content hash, and the sheet name.
+    // layout: Header, key, values, texts, row indexes, types, pool.
+    // cells are columnar (k = colx * nslots + slot), so only the columns read are paged in.
+    struct Key {
+        std::string path;
+        std::string sheet_name;
+        uint64_t size;
+        int64_t mtime;
+        uint64_t content_hash;
+
+        inline
+        std::string str() const {
+            return path + '\0' + sheet_name;
         }
-        // std::cerr << "ncols=" << ncolx << " nrows=" << nrowx << std::endl;
+    };
 
-        auto& row_cells = cells_[rowx];
-        row_cells.clear();
-        row_cells.reserve(ncolx);
-        int i = 0;
-        for (auto& c : row_nodes_[rowx].children("c")) {
-            std::string r = c.attribute("r").as_string();
-            int colx, rowx_;
-            std::tie(rowx_, colx) = parse_cellname(r);
-            if (rowx_ != rowx) {
-                throw Exception("bad. r=", r, " row=", rowx, " parsed_row=", rowx_);
+    struct Header {
+        char magic[8];
+        uint64_t size;
+        int64_t mtime;
+        uint64_t content_hash;
+        int32_t nslots;
+        int32_t ncols;
+        uint32_t key_size;
+        uint32_t reserved;
+        uint64_t pool_size;
+    };
+
+    static inline
+    const char* magic() {
+        return "XCSNAP01";
+    }
+
+    static inline
+    uint64_t hash(const char* p, size_t n, uint64_t h = 14695981039346656037ULL) {
+        // FNV-1a.
+        for (size_t i = 0; i < n; ++i) {
+            h = (h ^ static_cast<uint8_t>(p[i])) * 1099511628211ULL;
+        }
+        return h;
+    }
+
+    static inline
+    std::string path(const Key& key) {
+        auto k = key.str();
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.snap",
+                 static_cast<unsigned long long>(hash(k.data(), k.size())));
+        return snapshot_dir() + "/" + name;
+    }
+
+    static inline
+    size_t align8(size_t n) {
+        return (n + 7) & ~static_cast<size_t>(7);
+    }
+
+    struct Lock {
+        // exclusive across processes, while a sheet is decoded and saved.
+        int fd = -1;
+
+        inline
+        explicit Lock(const Key& key) {
+#ifndef _WIN32
+            fd = ::open((path(key) + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd >= 0 && ::flock(fd, LOCK_EX) != 0) {
+                ::close(fd);
+                fd = -1;
             }
-            std::string t = c.attribute("t").as_string();
-            auto s = c.attribute("s").as_int();
-            std::string v = c.child("v").text().as_string();
-            auto cell = Cell(rowx, colx, v, t, s, shared_string, style_sheet);
-            if (row_cells.size() <= colx) {
-                for (int j = row_cells.size(); j < colx; ++j) {
-                    // fill empty cells
-                    row_cells.push_back(Cell(rowx, j));
-                }
-                row_cells.push_back(std::move(cell));
-            } else {
-                // ???
-                row_cells[colx] = std::move(cell);
+#endif
+        }
+
+        Lock(const Lock&) = delete;
+        Lock& operator=(const Lock&) = delete;
+
+        inline
+        ~Lock() {
+#ifndef _WIN32
+            if (fd >= 0) {
+                ::flock(fd, LOCK_UN);
+                ::close(fd);
             }
+#endif
+        }
+    };
+
+    static inline
+    std::unique_ptr<Sheet> load(const Key& key, const std::string& rid) {
+        // nullptr: no snapshot, or a stale or broken one.
+        auto snapshot_path = path(key);
+        struct stat statbuf;
+        if (::stat(snapshot_path.c_str(), &statbuf) != 0) return nullptr;
+        std::shared_ptr<MappedFile> file;
+        try {
+            file = std::make_shared<MappedFile>(snapshot_path);
+        } catch (Exception&) {
+            return nullptr;
+        }
+        auto p = file->data;
+        auto end = file->data + file->size;
+        Header header;
+        if (file->size < sizeof(header)) return nullptr;
+        std::memcpy(&header, p, sizeof(header));
+        auto k = key.str();
+        if (std::memcmp(header.magic, magic(), 8) != 0 || header.size != key.size ||
+                header.mtime != key.mtime || header.content_hash != key.content_hash ||
+                header.key_size != k.size() || header.nslots < 0 || header.ncols < 0) {
+            return nullptr;
         }
-        for (int i = row_cells.size(); i < ncols(); ++i) {
-            // fill empty cells
-            row_cells.push_back(Cell(rowx, i));
+        p += sizeof(header);
+        if (static_cast<size_t>(end - p) < align8(k.size()) ||
+                std::memcmp(p, k.data(), k.size()) != 0) {
+            return nullptr;
         }
-        return row_cells[colx];
+        p += align8(k.size());
+        size_t ncells = static_cast<size_t>(header.nslots) * header.ncols;
+        size_t body = ncells * sizeof(Cell::Value) + ncells * sizeof(uint32_t) +
+                      header.nslots * sizeof(int32_t) + ncells + header.pool_size;
+        if (static_cast<size_t>(end - p) != body) return nullptr;
+        ColumnarCells columnar;
+        columnar.values = reinterpret_cast<const Cell::Value*>(p);
+        p += ncells * sizeof(Cell::Value);
+        columnar.texts = reinterpret_cast<const uint32_t*>(p);
+        p += ncells * sizeof(uint32_t);
+        auto row_indexes = reinterpret_cast<const int32_t*>(p);
+        p += header.nslots * sizeof(int32_t);
+        columnar.types = reinterpret_cast<const uint8_t*>(p);
+        p += ncells;
+        columnar.pool = p;
+        auto sheet = std::unique_ptr<Sheet>(new Sheet(rid, key.sheet_name));
+        sheet->map(file, std::vector<int>(row_indexes, row_indexes + header.nslots),
+                   header.ncols, columnar);
+        return sheet;
     }
 
-    inline
-    std::tuple<int, int> parse_cellname(std::string r) {
-        size_t p = std::string::npos;
-        int colx = 0;
-        for (size_t i = 0; i < r.size(); ++i) {
-            uint8_t c = r[i];
-            if ('A' <= c && c <= 'Z') {
-                colx = colx * ('Z' - 'A' + 1) + (c - 'A' + 1);
-            } else if ('0' <= c && c <= '9') {
-                p = i;
-                break;
-            } else {
-                throw Exception("bad position char. row");
+    static inline
+    bool save(const Key& key, Sheet& sheet) {
+        // sheet: every row decoded. false: not saved (sparse, too large, or io error).
+        auto& table = sheet.table_;
+        if (table.sparse_ || table.mapped_) return false;
+        int nslots = sheet.nrow_nodes_;
+        int ncols = sheet.ncols_;
+        size_t ncells = static_cast<size_t>(nslots) * ncols;
+        std::vector<Cell::Value> values(ncells);
+        std::vector<uint32_t> texts(ncells);
+        std::vector<uint8_t> types(ncells);
+        std::string pool(1, '\0');
+        std::unordered_map<std::string, uint32_t> offsets;
+        for (int colx = 0; colx < ncols; ++colx) {
+            for (int slot = 0; slot < nslots; ++slot) {
+                auto cell = table.cell(slot, sheet.row_indexes_[slot], colx);
+                size_t k = static_cast<size_t>(colx) * nslots + slot;
+                types[k] = cell.type;
+                if (cell.type == Cell::Type::kEmpty) continue;
+                values[k] = cell.value;
+                auto it = offsets.emplace(cell.c_str(), pool.size()).first;
+                if (it->second == pool.size()) {
+                    pool.append(it->first);
+                    pool.push_back('\0');
+                    if (pool.size() > std::numeric_limits<uint32_t>::max()) return false;
+                }
+                texts[k] = it->second;
             }
         }
-        colx--;
-        if (p == std::string::npos) {
-            throw Exception("bad position char. col");
+        auto k = key.str();
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic(), 8);
+        header.size = key.size;
+        header.mtime = key.mtime;
+        header.content_hash = key.content_hash;
+        header.nslots = nslots;
+        header.ncols = ncols;
+        header.key_size = k.size();
+        header.pool_size = pool.size();
+        k.resize(align8(k.size()), '\0');
+
+        // written aside, and renamed. readers see a whole snapshot or none.
+        auto snapshot_path = path(key);
+        auto tmp_path = sscat(snapshot_path, ".", ::getpid(), ".tmp");
+        {
+            std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(k.data(), k.size());
+            out.write(reinterpret_cast<const char*>(values.data()), ncells * sizeof(Cell::Value));
+            out.write(reinterpret_cast<const char*>(texts.data()), ncells * sizeof(uint32_t));
+            for (auto rowx : sheet.row_indexes_) {
+                int32_t v = rowx;
+                out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+            }
+            out.write(reinterpret_cast<const char*>(types.data()), ncells);
+            out.write(pool.data(), pool.size());
+            if (!out) {
+                ::unlink(tmp_path.c_str());
+                return false;
+            }
         }
-        int rowx = std::stoi(r.substr(p)) - 1;
-        return std::make_tuple(rowx, colx);
+        if (::rename(tmp_path.c_str(), snapshot_path.c_str()) != 0) {
+            ::unlink(tmp_path.c_str());
+            return false;
+        }
+        logv("snapshot: ", snapshot_path, " sheet: ", key.sheet_name, " saved.");
+        return true;
     }
 };
 
 
 struct Workbook {
-    ZipArchive::Ptr archive;
+    std::shared_ptr<ZipReader> archive;
     std::unordered_map<std::string, int> entry_indexes;
     std::vector<std::string> entry_names;  // for debug
     std::unordered_map<std::string, std::string> rels;
     int nsheets_ = -1;
+    bool binary = false;  // xlsb. parts are BIFF12 .bin, rels are still xml.
+    char delimiter = 0;   // csv or tsv. one sheet, no archive.
+    // snapshot key. content_hash: names, crc32s and sizes of the entries.
+    std::string path;
+    uint64_t file_size = 0;
+    int64_t mtime = 0;
+    uint64_t content_hash = 0;
 
     std::unordered_map<std::string, std::string> sheet_rid_by_name;
     std::unordered_map<std::string, std::string> sheet_name_by_rid;
-    std::unordered_map<std::string, Sheet> sheets;
-    std::shared_ptr<std::vector<std::string>> shared_string;
+    // loaded once per rid. other sheets load concurrently.
+    std::unordered_map<std::string, std::shared_future<Sheet*>> sheets;
+    std::vector<std::unique_ptr<Sheet>> loaded_sheets;
+    std::shared_ptr<SharedStrings> shared_string;
     std::shared_ptr<StyleSheet> style_sheet;
 
     std::mutex sheet_mutex;
@@ -545,25 +2720,40 @@ struct Workbook {
 
     inline
     explicit Workbook(std::string filename)
-            : shared_string(new std::vector<std::string>()) {
+            : shared_string(nullptr) {
         struct stat statbuf;
         if (::stat(filename.c_str(), &statbuf) != 0) {
             throw Exception("file=", filename, " does not exist.");
         }
 
-        archive = ZipFile::Open(filename);
+        archive = std::make_shared<ZipReader>(filename);
+        path = filename;
+#ifndef _WIN32
+        if (char* real = ::realpath(filename.c_str(), nullptr)) {
+            path = real;
+            std::free(real);
+        }
+#endif
+        file_size = statbuf.st_size;
+        mtime = statbuf.st_mtime;
 
         int max_sheet_id = -1;
-        size_t count = archive->GetEntriesCount();
+        size_t count = archive->size();
         std::vector<int> rel_entries;
+        content_hash = Snapshot::hash(nullptr, 0);
         for (size_t i = 0; i < count; ++i) {
-            auto entry = archive->GetEntry(static_cast<int>(i));
-            std::string fullname = entry->GetFullName();
+            auto& entry = archive->entry(i);
+            std::string fullname = entry.name;
+            content_hash = Snapshot::hash(fullname.c_str(), fullname.size() + 1, content_hash);
+            content_hash = Snapshot::hash(reinterpret_cast<const char*>(&entry.crc32),
+                                          sizeof(entry.crc32), content_hash);
+            content_hash = Snapshot::hash(reinterpret_cast<const char*>(&entry.size),
+                                          sizeof(entry.size), content_hash);
             entry_names.push_back(fullname);
             auto p = fullname.rfind('.');
             if (p == std::string::npos) continue;
             auto ext = fullname.substr(p);
-            if (ext == ".xml") {
+            if (ext == ".xml" || ext == ".bin") {
             } else if (ext == ".rels") {
                 rel_entries.push_back(i);
             } else {
@@ -573,26 +2763,45 @@ struct Workbook {
             logv("entry_index:", i, "  entry_name:", fullname);
         }
 
-        if (entry_indexes.count("xl/workbook.xml") == 0) {
-            throw Exception("cant find xl/workbook.xml !!");
-        }
-        if (entry_indexes.count("xl/sharedStrings.xml") == 0) {
-            throw Exception("cant find xl/sharedStrings.xml !!");
-        }
-        if (entry_indexes.count("xl/styles.xml") == 0) {
-            throw Exception("cant find xl/styles.xml !!");
+        binary = entry_indexes.count("xl/workbook.xml") == 0 &&
+                 entry_indexes.count("xl/workbook.bin") != 0;
+        std::string ext = binary ? ".bin" : ".xml";
+        for (auto part : {"xl/workbook", "xl/sharedStrings", "xl/styles"}) {
+            if (entry_indexes.count(part + ext) == 0) {
+                throw Exception("cant find ", part, ext, " !!");
+            }
         }
         if (rel_entries.empty()) {
             throw Exception("cant find rels !!");
         }
 
-        for (int i : rel_entries) {
-            auto doc = load_doc(i);
+        // rels and workbook.xml are needed to find any sheet.
+        std::vector<std::unique_ptr<pugi::xml_document>> rel_docs(rel_entries.size());
+        std::unique_ptr<pugi::xml_document> workbook_doc;
+        std::vector<std::pair<std::string, std::string>> bundles;  // workbook.bin
+        std::vector<std::function<void()>> parts;
+        auto workbook_index = entry_indexes["xl/workbook" + ext];
+        size_t parts_size = entry_size(workbook_index);
+        for (size_t k = 0; k < rel_entries.size(); ++k) {
+            parts.push_back([&, k]() { rel_docs[k] = load_doc(rel_entries[k]); });
+            parts_size += entry_size(rel_entries[k]);
+        }
+        if (binary) {
+            parts.push_back([&]() { bundles = load_bundles(read_entry(workbook_index)); });
+        } else {
+            parts.push_back([&]() { workbook_doc = load_doc(workbook_index); });
+        }
+        load_parts(parts, parts_size);
+
+        for (size_t k = 0; k < rel_entries.size(); ++k) {
+            int i = rel_entries[k];
+            auto& doc = rel_docs[k];
             for (auto rel : doc->child("Relationships").children("Relationship")) {
                 auto rid = rel.attribute("Id").as_string();
                 std::string target = rel.attribute("Target").as_string();
-                auto ext = target.substr(target.size()-4);
-                if (ext != ".xml") continue;
+                if (target.size() < 4 || target.compare(target.size() - 4, 4, ext) != 0) {
+                    continue;
+                }
                 std::string type = rel.attribute("Type").as_string();
                 if (!type.empty() && !is_reltype_worksheet(type)) continue;
                 auto head = target.substr(0, 3);
@@ -609,33 +2818,119 @@ struct Workbook {
             }
         }
 
-        auto workbook_doc = load_doc("xl/workbook.xml");
-        for (auto sheet : workbook_doc->child("workbook").child("sheets").children("sheet")) {
-            // auto sheet_id = sheet.attribute("sheetId").as_int();
-            auto sheet_rid = sheet.attribute("r:id").as_string();
-            auto sheet_name = sheet.attribute("name").as_string();
+        if (!binary) {
+            for (auto sheet : workbook_doc->child("workbook").child("sheets").children("sheet")) {
+                // auto sheet_id = sheet.attribute("sheetId").as_int();
+                bundles.emplace_back(sheet.attribute("r:id").as_string(),
+                                     sheet.attribute("name").as_string());
+            }
+        }
+        for (auto& bundle : bundles) {
+            auto& sheet_rid = bundle.first;
+            auto& sheet_name = bundle.second;
             sheet_rid_by_name[sheet_name] = sheet_rid;
             sheet_name_by_rid[sheet_rid] = sheet_name;
             logv("sheet_rid:", sheet_rid, "  sheet_name:", sheet_name);
         }
 
-        auto shared_string_doc = load_doc("xl/sharedStrings.xml");
-        for (auto si : shared_string_doc->child("sst").children("si")) {
-            std::string text;
-            for (auto child : si.children()) {
-                std::string name = child.name();
-                if (name == "t") {
-                    text.append(child.text().as_string());
-                } else if (name == "r") {
-                    for (auto node : child.children("t")) {
-                        text.append(node.text().as_string());
-                    }
-                }
+        // loaded on first use. the loaders do not refer to this workbook.
+        auto reader = archive;
+        auto shared_string_index = entry_indexes["xl/sharedStrings" + ext];
+        auto style_index = entry_indexes["xl/styles" + ext];
+        if (binary) {
+            shared_string = std::make_shared<SharedStrings>([reader, shared_string_index](
+                    SharedStrings& strings) {
+                auto source = read_entry(*reader, shared_string_index);
+                strings.assign_binary(source.data(), source.size());
+            });
+            style_sheet = std::make_shared<StyleSheet>([reader, style_index](
+                    StyleSheet& styles) {
+                auto source = read_entry(*reader, style_index);
+                styles.parse(source.data(), source.size());
+            });
+            return;
+        }
+        shared_string = std::make_shared<SharedStrings>([reader, shared_string_index](
+                SharedStrings& strings) {
+            auto size = reader->entry(shared_string_index).size;
+            if (auto view = reader->view(shared_string_index)) {
+                // stored entry. no copy.
+                strings.assign(reader, view, size);
+            } else {
+                std::string source(size, '\0');
+                if (size > 0) reader->read_entry(shared_string_index, &source[0], size);
+                strings.assign(std::move(source));
+            }
+        });
+        style_sheet = std::make_shared<StyleSheet>([reader, style_index](StyleSheet& styles) {
+            styles.parse(*load_doc(*reader, style_index));
+        });
+    }
+
+    inline
+    Workbook(std::string filename, char delimiter_)
+            : delimiter(delimiter_) {
+        // csv/tsv source. the sheet is indexed now. its name in the book is "".
+        auto file = std::make_shared<MappedFile>(filename);
+        auto sheet = std::unique_ptr<Sheet>(new Sheet(filename, file, delimiter));
+        std::promise<Sheet*> promise;
+        promise.set_value(sheet.get());
+        sheets.emplace("", promise.get_future().share());
+        sheet_rid_by_name[""] = "";
+        sheet_name_by_rid[""] = "";
+        loaded_sheets.push_back(std::move(sheet));
+    }
+
+    static inline
+    std::vector<std::pair<std::string, std::string>> load_bundles(const std::string& source) {
+        // workbook.bin: (r:id, name) of each BrtBundleSh, in sheet order.
+        std::vector<std::pair<std::string, std::string>> bundles;
+        auto p = source.data();
+        auto end = p + source.size();
+        xlsb::Record record;
+        int r;
+        while ((r = xlsb::next_record(p, end, record)) == 1) {
+            if (record.type != xlsb::kBundleSh) continue;
+            // hsState, iTabID, strRelID, strName.
+            auto q = record.data + 8;
+            auto q_end = record.data + record.size;
+            std::string rid, name;
+            if (record.size < 8 || !xlsb::read_string(q, q_end, rid) ||
+                    !xlsb::read_string(q, q_end, name)) {
+                throw Exception("workbook.bin: bad BrtBundleSh.");
             }
-            shared_string->push_back(text);
+            bundles.emplace_back(rid, name);
         }
+        if (r < 0) throw Exception("workbook.bin: unexpected eof.");
+        return bundles;
+    }
 
-        style_sheet = std::make_shared<StyleSheet>(load_doc("xl/styles.xml"));
+    static inline
+    void load_parts(std::vector<std::function<void()>>& parts, size_t size) {
+        // inflates and parses parts in parallel, if they are large enough.
+        static const size_t parallel_min_size = 1024 * 1024;
+        if (parts.size() < 2 || size < parallel_min_size) {
+            for (auto& part : parts) part();
+            return;
+        }
+        std::vector<std::future<void>> futures;
+        for (size_t k = 1; k < parts.size(); ++k) {
+            futures.push_back(std::async(std::launch::async, parts[k]));
+        }
+        std::exception_ptr error;
+        try {
+            parts[0]();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        for (auto& future : futures) {
+            try {
+                future.get();
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
     }
 
     static inline
@@ -648,26 +2943,55 @@ struct Workbook {
     }
 
     inline
-    std::string read_entry(int index) {
+    size_t entry_size(int index) {
         if (index < 0 || entry_names.size() <= index) {
             throw Exception("entry_index=", index, ": out of range.");
         }
-        auto entry = archive->GetEntry(index);
-        auto stream_ptr = entry->GetDecompressionStream();
-        if (stream_ptr == nullptr) {
-            throw Exception("entry=", entry_names[index], ": cant decode stream.");
-        }
-        std::stringstream ss;
-        ss << stream_ptr->rdbuf();
-        return ss.str();
+        return archive->entry(index).size;
+    }
+
+    inline
+    void inflate_entry(int index, char* buffer, size_t size) {
+        // decompress straight into buffer. size is entry_size(index).
+        // thread-safe. no lock on the archive.
+        archive->read_entry(index, buffer, size);
+    }
+
+    inline
+    std::string read_entry(int index) {
+        std::string source(entry_size(index), '\0');
+        if (!source.empty()) inflate_entry(index, &source[0], source.size());
+        return source;
+    }
+
+    static inline
+    std::string read_entry(ZipReader& reader, int index) {
+        std::string source(reader.entry(index).size, '\0');
+        if (!source.empty()) reader.read_entry(index, &source[0], source.size());
+        return source;
     }
 
     inline
     std::unique_ptr<pugi::xml_document> load_doc(int index) {
-        auto xmlsource = read_entry(index);
-        // std::cerr << xmlsource << std::endl;
+        return load_doc(*archive, index);
+    }
+
+    static inline
+    std::unique_ptr<pugi::xml_document> load_doc(ZipReader& reader, int index) {
+        // inflate once into a pugixml owned buffer, and parse it in place.
+        auto size = reader.entry(index).size;
+        auto buffer = static_cast<char*>(pugi::get_memory_allocation_function()(size + 1));
+        if (buffer == nullptr) {
+            throw Exception("entry=", reader.entry(index).name, ": out of memory. size=", size);
+        }
+        try {
+            reader.read_entry(index, buffer, size);
+        } catch (...) {
+            pugi::get_memory_deallocation_function()(buffer);
+            throw;
+        }
         auto doc = std::unique_ptr<pugi::xml_document>(new pugi::xml_document());
-        auto result = doc->load_string(xmlsource.c_str());
+        auto result = doc->load_buffer_inplace_own(buffer, size);
         if (!result) {
             throw Exception("parse error!!");
         }
@@ -686,20 +3010,110 @@ struct Workbook {
     inline int nsheets() { return nsheets_; }
 
     inline
-    Sheet& sheet(std::string rid) {
+    size_t memory_size() {
+        // approximate: loaded sheets and shared strings.
         std::lock_guard<std::mutex> lock(sheet_mutex);
-        auto it = sheets.find(rid);
-        if (it != sheets.end()) {
-            return it->second;
-        }
-        auto entry_name = rels[rid];
-        auto sheet_name = sheet_name_by_rid[rid];
-        auto doc = load_doc(entry_name);
-        // auto sheet = Sheet(rid, sheet_name, std::move(doc), shared_string, style_sheet);
-        auto em = sheets.emplace(std::piecewise_construct, std::make_tuple(rid),
-                                 std::make_tuple(rid, sheet_name, std::move(doc),
-                                                 shared_string, style_sheet));
-        return em.first->second;
+        size_t size = 0;
+        for (auto& sheet : loaded_sheets) size += sheet->memory_size();
+        if (shared_string) size += shared_string->memory_size();
+        return size;
+    }
+
+    inline
+    Sheet& sheet(std::string rid) {
+        std::promise<Sheet*> promise;
+        std::shared_future<Sheet*> loading;
+        std::string entry_name, sheet_name;
+        {
+            std::lock_guard<std::mutex> lock(sheet_mutex);
+            auto it = sheets.find(rid);
+            if (it != sheets.end()) {
+                loading = it->second;
+            } else {
+                // this thread loads it. others wait on the future.
+                sheets.emplace(rid, promise.get_future().share());
+                entry_name = rels[rid];
+                sheet_name = sheet_name_by_rid[rid];
+            }
+        }
+        // not under sheet_mutex. the loader takes it to publish the sheet.
+        if (loading.valid()) return *loading.get();
+        try {
+            auto it = entry_indexes.find(entry_name);
+            if (it == entry_indexes.end()) {
+                throw Exception("entry=", entry_name, ": not found.");
+            }
+            std::unique_ptr<Sheet> sheet;
+            if (!snapshot_dir().empty()) {
+                sheet = snapshot_sheet(rid, sheet_name, it->second);
+            } else {
+                // styles are parsed while the sheet is inflated, if the sheet is large.
+                std::future<void> styles;
+                static const size_t prefetch_min_size = 1024 * 1024;
+                if (!style_sheet->loaded_.load(std::memory_order_acquire) &&
+                        entry_size(it->second) >= prefetch_min_size) {
+                    auto styles_ = style_sheet;
+                    styles = std::async(std::launch::async, [styles_]() { styles_->load(); });
+                }
+                sheet.reset(new Sheet(rid, sheet_name, archive, it->second,
+                                      shared_string, style_sheet));
+                if (styles.valid()) styles.get();
+            }
+            auto ptr = sheet.get();
+            {
+                std::lock_guard<std::mutex> lock(sheet_mutex);
+                loaded_sheets.push_back(std::move(sheet));
+            }
+            promise.set_value(ptr);
+            return *ptr;
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    inline
+    std::unique_ptr<Sheet> snapshot_sheet(const std::string& rid, const std::string& sheet_name,
+                                          int index) {
+        // mapped from its snapshot, or decoded and saved by one process while others wait.
+        Snapshot::Key key{path, sheet_name, file_size, mtime, content_hash};
+        if (auto sheet = Snapshot::load(key, rid)) return sheet;
+        Snapshot::Lock lock(key);
+        if (auto sheet = Snapshot::load(key, rid)) return sheet;
+        auto sheet = std::unique_ptr<Sheet>(new Sheet(rid, sheet_name, archive, index,
+                                                      shared_string, style_sheet));
+        sheet->preload(1);
+        if (!Snapshot::save(key, *sheet)) {
+            logv("snapshot: ", Snapshot::path(key), " sheet: ", sheet_name, " not saved.");
+        }
+        return sheet;
+    }
+
+    inline
+    bool streamable() {
+        // RowCursor reads xml sheets only. snapshots are made of whole sheets.
+        return !binary && delimiter == 0 && snapshot_dir().empty();
+    }
+
+    inline
+    RowCursor row_cursor(std::string rid) {
+        // xml only. xlsb and csv sheets are read by sheet().
+        if (!streamable()) {
+            throw Exception("r:id=", rid, ": no row cursor for xlsb or csv.");
+        }
+        auto it = entry_indexes.find(rels[rid]);
+        if (it == entry_indexes.end()) {
+            throw Exception("r:id=", rid, ": sheet entry not found.");
+        }
+        return RowCursor(archive->stream(it->second), shared_string, style_sheet);
+    }
+
+    inline
+    RowCursor row_cursor_by_name(std::string name) {
+        if (sheet_rid_by_name.count(name) == 0) {
+            throw Exception("sheet_name=", name, ": not found.");
+        }
+        return row_cursor(sheet_rid_by_name[name]);
     }
 
     inline
@@ -208,7 +208,9 @@ struct YamlConfig {
     std::string target;
     std::string target_sheet_name;
     std::string target_xls_path;
+    char target_delimiter = 0;  // csv:///, tsv:///
     int row;
+    boost::optional<int> limit = boost::none;
     std::vector<Handler> handlers;
     std::vector<Field> fields;
 
@@ -240,13 +242,26 @@ struct YamlConfig {
         }
         target = doc["target"].as<std::string>();
         row = doc["row"].as<int>();
+        if (auto n = doc["limit"]) {
+            limit = n.as<int>();
+            if (limit.value() < 0) {
+                throw EXCEPTION(path, ": limit must be >= 0.");
+            }
+        }
         if (target.substr(0, 7) == "xls:///") {
             target_xls_path = target.substr(7);
+        } else if (target.substr(0, 7) == "csv:///") {
+            target_xls_path = target.substr(7);
+            target_delimiter = ',';
+        } else if (target.substr(0, 7) == "tsv:///") {
+            target_xls_path = target.substr(7);
+            target_delimiter = '\t';
         } else {
             target_xls_path = target;
         }
         size_t pos;
-        if ((pos = target_xls_path.find('#')) != std::string::npos) {
+        // csv has no sheet.
+        if (target_delimiter == 0 && (pos = target_xls_path.find('#')) != std::string::npos) {
             target_sheet_name = target_xls_path.substr(pos+1);
             target_xls_path = target_xls_path.substr(0, pos);
         }
@@ -32,6 +32,16 @@ done
 #     ./xlsxconverter --jobs 2 ${ARGS2} ${TARGETS}
 # done
 
+echo "--------------------------------"
+echo "c++ xlsxconverter... jobs 16 (5 targets on one sheet)"
+ARGS3='--timezone +0900 --xls_search_path tests/xlsx --yaml_search_path tests/yaml --quiet'
+OUT3=`mktemp -d`
+SHARED='dummy1csv.yaml dummy1fix.yaml dummy1lua.yaml dummy1mp.yaml dummy1mul.yaml'
+time for i in {1..100}; do
+    ./xlsxconverter --jobs 16 ${ARGS3} --output_base_path ${OUT3} ${SHARED}
+done
+rm -rf ${OUT3}
+
 echo "--------------------------------"
 echo "c++ xlsxconverter... jobs 1"
 time for i in {1..100}; do
@@ -0,0 +1,58 @@
+#include <boost/assert.hpp>
+#include <chrono>
+#include "utils.hpp"
+#include "xlsx.hpp"
+
+// inflate throughput (MB/s of inflated data) of sheet and sharedStrings entries,
+// for each xlsx::Inflater.
+double measure(xlsx::ZipReader& reader, int index, std::string& out) {
+    using clock = std::chrono::steady_clock;
+    int n = 0;
+    auto start = clock::now();
+    double elapsed = 0.0;
+    do {
+        reader.read_entry(index, &out[0], out.size());
+        n++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < 0.2);
+    return out.size() * n / elapsed / (1024.0 * 1024.0);
+}
+
+int main(int argc, char** argv) {
+    using namespace xlsxconverter;
+
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) paths.push_back(argv[i]);
+    if (paths.empty()) {
+        paths.push_back("tests/xlsx/sample.xlsx");
+        paths.push_back("tests/xlsx/sample2.xlsx");
+    }
+    std::vector<std::shared_ptr<xlsx::Inflater>> inflaters = {
+        std::make_shared<xlsx::ZlibInflater>(),
+        std::make_shared<xlsx::FastInflater>(),
+    };
+
+    for (auto& path : paths) {
+        xlsx::ZipReader reader(path);
+        for (int i = 0; i < reader.size(); ++i) {
+            auto& entry = reader.entry(i);
+            bool sheet = entry.name.find("xl/worksheets/") == 0;
+            if (!sheet && entry.name != "xl/sharedStrings.xml") continue;
+            if (entry.method != 8 || entry.size == 0) continue;
+
+            std::string expected;
+            std::string line = path + ":" + entry.name + " (" +
+                               std::to_string(entry.size / 1024) + "KB)";
+            for (auto& inflater : inflaters) {
+                reader.inflater = inflater;
+                std::string out(entry.size, '\0');
+                auto mbps = measure(reader, i, out);
+                if (expected.empty()) expected = out;
+                BOOST_ASSERT(out == expected);
+                line += xlsx::sscat("  ", inflater->name(), "=", static_cast<int>(mbps), "MB/s");
+            }
+            utils::log(line);
+        }
+    }
+    return 0;
+}
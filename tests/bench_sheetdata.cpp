@@ -0,0 +1,75 @@
+#include <boost/assert.hpp>
+#include <chrono>
+#include "utils.hpp"
+#include "xlsx.hpp"
+
+// sheetData decoding throughput (MB/s of sheet xml), pugixml dom vs sheetdata tokenizer.
+// both build the sheet and decode every row. cells must be the same.
+template<class F>
+double measure(size_t size, F make) {
+    using clock = std::chrono::steady_clock;
+    int n = 0;
+    auto start = clock::now();
+    double elapsed = 0.0;
+    do {
+        auto sheet = make();
+        sheet->preload(1);
+        n++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < 0.2);
+    return size * n / elapsed / (1024.0 * 1024.0);
+}
+
+void compare(xlsx::Sheet& a, xlsx::Sheet& b) {
+    BOOST_ASSERT(a.nrows() == b.nrows());
+    BOOST_ASSERT(a.ncols() == b.ncols());
+    for (int j = 0; j < a.nrows(); ++j) {
+        for (int i = 0; i < a.ncols(); ++i) {
+            auto x = a.cell(j, i);
+            auto y = b.cell(j, i);
+            BOOST_ASSERT(x.type == y.type);
+            BOOST_ASSERT(x.as_str() == y.as_str());
+            BOOST_ASSERT(x.value.i == y.value.i);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace xlsxconverter;
+
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) paths.push_back(argv[i]);
+    if (paths.empty()) {
+        paths.push_back("tests/xlsx/sample.xlsx");
+        paths.push_back("tests/xlsx/sample2.xlsx");
+    }
+
+    for (auto& path : paths) {
+        xlsx::Workbook book(path);
+        auto& archive = *book.archive;
+        for (int i = 0; i < archive.size(); ++i) {
+            auto& entry = archive.entry(i);
+            if (entry.name.find("xl/worksheets/") != 0) continue;
+            std::string source(entry.size, '\0');
+            if (entry.size > 0) archive.read_entry(i, &source[0], source.size());
+
+            auto dom = [&]() {
+                auto doc = std::unique_ptr<pugi::xml_document>(new pugi::xml_document());
+                doc->load_buffer(source.data(), source.size(),
+                                 pugi::parse_default, pugi::encoding_utf8);
+                return std::unique_ptr<xlsx::Sheet>(new xlsx::Sheet(
+                    "", entry.name, std::move(doc), book.shared_string, book.style_sheet));
+            };
+            auto tokenizer = [&]() {
+                return std::unique_ptr<xlsx::Sheet>(new xlsx::Sheet(
+                    "", entry.name, source, book.shared_string, book.style_sheet));
+            };
+            compare(*dom(), *tokenizer());
+
+            utils::log(path, ":", entry.name, " (", entry.size / 1024, "KB)",
+                       "  pugixml=", static_cast<int>(measure(source.size(), dom)), "MB/s",
+                       "  sheetdata=", static_cast<int>(measure(source.size(), tokenizer)), "MB/s");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+return {
+    {
+        fields = {
+            id = 1,
+            country_code = "JP",
+            family_name = "あああ",
+            first_name = "ししし",
+            birthday = "1969-09-05T00:00:00+0900",
+            preference_id = 37,
+            float_value = 0.100000
+        },
+        pk = 1
+    },
+    {
+        fields = {
+            id = 2,
+            country_code = "JP",
+            family_name = "いいい",
+            first_name = "すすす",
+            birthday = "1982-05-30T00:00:00+0900",
+            preference_id = 15,
+            float_value = 123456789123456000.000000
+        },
+        pk = 2
+    },
+    {
+        fields = {
+            id = 3,
+            country_code = "JP",
+            family_name = "ううう",
+            first_name = "せせせ",
+            birthday = "1967-01-01T00:00:00+0900",
+            preference_id = 14,
+            float_value = 0.001000
+        },
+        pk = 3
+    },
+    {
+        fields = {
+            id = 4,
+            country_code = "JP",
+            family_name = "えええ",
+            first_name = "そそそ",
+            birthday = "1953-11-18T00:00:00+0900",
+            preference_id = 35,
+            float_value = 0.000000
+        },
+        pk = 4
+    },
+    {
+        fields = {
+            id = 5,
+            country_code = "US",
+            family_name = "おおお",
+            first_name = "ななな",
+            birthday = "1969-04-06T00:00:00+0900",
+            preference_id = 10,
+            float_value = 0.000000
+        },
+        pk = 5
+    },
+    {
+        fields = {
+            id = 6,
+            country_code = "US",
+            family_name = "かかか",
+            first_name = "ににに",
+            birthday = "1982-05-30T00:00:00+0900",
+            preference_id = 38,
+            float_value = 1234567889999999949017523846387767969293706371681249493252141224420457219580418960285850838621282816821699914102910337679360.000000
+        },
+        pk = 6
+    },
+    {
+        fields = {
+            id = 7,
+            country_code = "JP",
+            family_name = "ききき",
+            first_name = "ぬぬぬ",
+            birthday = "1920-04-08T00:00:00+0900",
+            preference_id = 6,
+            float_value = 1.500000
+        },
+        pk = 7
+    },
+    {
+        fields = {
+            id = 8,
+            country_code = "FR",
+            family_name = "くくく",
+            first_name = "ねねね",
+            birthday = "1951-03-02T00:00:00+0900",
+            preference_id = 34,
+            float_value = 0.000000
+        },
+        pk = 8
+    },
+    {
+        fields = {
+            id = 9,
+            country_code = "FR",
+            family_name = "けけけ",
+            first_name = "ののの",
+            birthday = "1919-06-28T00:00:00+0900",
+            preference_id = 35,
+            float_value = 0.123456
+        },
+        pk = 9
+    },
+    {
+        fields = {
+            id = 10,
+            country_code = "JP",
+            family_name = "こここ",
+            first_name = "ははは",
+            birthday = "1924-11-24T00:00:00+0900",
+            preference_id = 34,
+            float_value = 100.000000
+        },
+        pk = 10
+    },
+    {
+        fields = {
+            id = 11,
+            country_code = "JP",
+            family_name = "さささ",
+            first_name = "¥１００",
+            birthday = "1936-12-11T00:00:00+0900",
+            preference_id = 5,
+            float_value = 1.000000
+        },
+        pk = 11
+    },
+    {
+        fields = {
+            id = 12,
+            country_code = "JP",
+            family_name = "あい,,,う\nえお",
+            first_name = "かき\"く\"け\nこ",
+            birthday = "1936-12-11T00:00:00+0900",
+            preference_id = 5,
+            float_value = 100.000000
+        },
+        pk = 12
+    }
+}
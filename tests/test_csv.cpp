@@ -0,0 +1,143 @@
+#include <boost/assert.hpp>
+#include <cstdio>
+#include <random>
+#include "utils.hpp"
+#include "xlsx.hpp"
+
+// csv/tsv source: the kernels against a naive RFC 4180 reader, and Sheet cells.
+std::vector<std::vector<std::string>> naive(const std::string& s, char delim) {
+    std::vector<std::vector<std::string>> records;
+    std::vector<std::string> record;
+    std::string field;
+    bool quoted = false, at_start = true, closed = false, pending = false;
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        pending = true;
+        if (quoted) {
+            if (c == '"') {
+                quoted = false;
+                closed = true;
+            } else {
+                field.push_back(c);
+            }
+            continue;
+        }
+        if (c == '"' && (at_start || closed)) {
+            if (closed) field.push_back('"');
+            quoted = true;
+            at_start = closed = false;
+            continue;
+        }
+        bool after_quote = closed;
+        closed = false;
+        if (c == delim) {
+            record.push_back(field);
+            field.clear();
+            at_start = true;
+            continue;
+        }
+        if (c == '\n') {
+            if (!after_quote && !field.empty() && field.back() == '\r') field.pop_back();
+            record.push_back(field);
+            records.push_back(record);
+            record.clear();
+            field.clear();
+            at_start = true;
+            pending = false;
+            continue;
+        }
+        at_start = false;
+        field.push_back(c);
+    }
+    if (pending) {
+        if (!quoted && !closed && !field.empty() && field.back() == '\r') field.pop_back();
+        record.push_back(field);
+        records.push_back(record);
+    }
+    return records;
+}
+
+std::vector<std::vector<std::string>> scan(const std::string& s, char delim) {
+    namespace cd = xlsx::csvdata;
+    std::vector<std::vector<std::string>> records;
+    auto p = s.data();
+    auto end = p + s.size();
+    std::string buffer;
+    while (p < end) {
+        int nfields;
+        auto q = cd::scan_record(p, end, delim, nfields);
+        std::vector<std::string> record;
+        for (auto f = p; f != nullptr;) {
+            const char* v;
+            size_t v_size;
+            f = cd::next_field(f, q, delim, buffer, v, v_size);
+            record.emplace_back(v, v_size);
+        }
+        BOOST_ASSERT(static_cast<int>(record.size()) == nfields);
+        records.push_back(record);
+        p = q == end ? end : q + 1;
+    }
+    return records;
+}
+
+int main(int argc, char** argv) {
+    using namespace xlsxconverter;
+    namespace cd = xlsx::csvdata;
+    using Type = xlsx::Cell::Type;
+
+    auto r = scan("a,\"b,\"\"c\"\"\nd\",e\r\n,,\"\"\n", ',');
+    BOOST_ASSERT(r.size() == 2);
+    BOOST_ASSERT(r[0].size() == 3 && r[0][1] == "b,\"c\"\nd" && r[0][2] == "e");
+    BOOST_ASSERT(r[1].size() == 3 && r[1][0].empty() && r[1][2].empty());
+    // a quote inside a field is a char.
+    r = scan("ab\"c,d\n", ',');
+    BOOST_ASSERT(r[0].size() == 2 && r[0][0] == "ab\"c");
+
+    for (auto s : {"0", "-12", "+7", "1.5", ".5", "1.", "1E5", "1.5e-05"}) {
+        BOOST_ASSERT(cd::is_number(s, std::strlen(s)));
+    }
+    for (auto s : {"", "-", ".", "1E", "1e+", " 1", "1 ", "0x10", "1,000", "TRUE", "1.5.5"}) {
+        BOOST_ASSERT(!cd::is_number(s, std::strlen(s)));
+    }
+
+    // random records, across the 16 byte blocks.
+    int errors = 0;
+    std::mt19937_64 rng(1);
+    const char chars[] = "ab1,\t\"\n\r ";
+    for (int k = 0; k < 100000; ++k) {
+        std::string s;
+        for (int i = rng() % 80; i > 0; --i) s.push_back(chars[rng() % (sizeof(chars) - 1)]);
+        char delim = k % 2 ? ',' : '\t';
+        if (scan(s, delim) != naive(s, delim)) {
+            utils::log("csv: [", s, "]");
+            errors++;
+        }
+    }
+
+    // sheet: BOM, CRLF, empty lines, typed cells.
+    char path[] = "/tmp/test_csv_XXXXXX";
+    int fd = mkstemp(path);
+    BOOST_ASSERT(fd >= 0);
+    std::string source = "\xef\xbb\xbfid,name,rate\r\n1,\"x,y\",0.25\r\n\r\n3,007,\r\nz,,-0\r\n";
+    BOOST_ASSERT(write(fd, source.data(), source.size()) == static_cast<ssize_t>(source.size()));
+    close(fd);
+    {
+        xlsx::Workbook book(path, ',');
+        auto& sheet = book.sheet_by_name("");
+        BOOST_ASSERT(sheet.nrows() == 5 && sheet.ncols() == 3);
+        BOOST_ASSERT(sheet.slot(2) == -1);
+        BOOST_ASSERT(sheet.cell(0, 0).type == Type::kString && sheet.cell(0, 0).as_str() == "id");
+        BOOST_ASSERT(sheet.cell(1, 0).type == Type::kInt && sheet.cell(1, 0).as_int() == 1);
+        BOOST_ASSERT(sheet.cell(1, 1).as_str() == "x,y");
+        BOOST_ASSERT(sheet.cell(1, 2).type == Type::kDouble && sheet.cell(1, 2).as_double() == 0.25);
+        BOOST_ASSERT(sheet.cell(3, 1).type == Type::kInt && sheet.cell(3, 1).as_str() == "007");
+        BOOST_ASSERT(sheet.cell(3, 2).type == Type::kEmpty);
+        BOOST_ASSERT(sheet.cell(4, 0).type == Type::kString && sheet.cell(4, 1).type == Type::kEmpty);
+        BOOST_ASSERT(!book.streamable());
+    }
+    std::remove(path);
+
+    utils::log("csv errors: ", errors);
+    BOOST_ASSERT(errors == 0);
+    return 0;
+}
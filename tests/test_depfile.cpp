@@ -0,0 +1,60 @@
+#include <boost/assert.hpp>
+#include <cstdio>
+#include "utils.hpp"
+#include "arg_config.hpp"
+#include "yaml_config.hpp"
+#include "depfile.hpp"
+
+// --depfile: the prerequisites of an output, and how make reads them.
+int main(int argc, char** argv) {
+    using namespace xlsxconverter;
+
+    // make: a space and # are escaped by a backslash, $ by $.
+    BOOST_ASSERT(Depfile::escape("tests/yaml/sample.yaml") == "tests/yaml/sample.yaml");
+    BOOST_ASSERT(Depfile::escape("a b#c$d") == "a\\ b\\#c$$d");
+    BOOST_ASSERT(Depfile::escape("$$") == "$$$$");
+
+    char dir[] = "/tmp/test_depfile_XXXXXX";
+    BOOST_ASSERT(mkdtemp(dir) != nullptr);
+    std::vector<std::string> args = {"xlsxconverter", "--depfile",
+                                     "--xls_search_path", "tests/xlsx",
+                                     "--yaml_search_path", "tests/yaml",
+                                     "--output_base_path", dir};
+    std::vector<char*> argv_;
+    for (auto& arg : args) argv_.push_back(&arg[0]);
+    ArgConfig arg_config(argv_.size(), argv_.data());
+
+    // the yaml, its workbooks, and those of the relations. each once.
+    YamlConfig sample("sample.yaml", arg_config);
+    auto dependencies = Depfile::dependencies(sample);
+    std::vector<std::string> expected = {
+        "tests/yaml/sample.yaml", "tests/xlsx/sample.xlsx", "tests/yaml/country.yaml",
+    };
+    BOOST_ASSERT(dependencies == expected);
+
+    // the handler output is the target.
+    auto& handler = sample.handlers[0];
+    Depfile::write(handler, {"tests/yaml/sample.yaml", "my book#1.xlsx", "$cost.xlsx"});
+    auto depfile_path = handler.get_output_path() + ".d";
+    auto text = utils::fs::readfile(depfile_path);
+    BOOST_ASSERT(text == handler.get_output_path() + ": \\\n"
+                         "  tests/yaml/sample.yaml \\\n"
+                         "  my\\ book\\#1.xlsx \\\n"
+                         "  $$cost.xlsx\n");
+    std::remove(depfile_path.c_str());
+
+    // a template source is a prerequisite of its output only.
+    YamlConfig tmpl("countrytmpl.yaml", arg_config);
+    Depfile::write(tmpl.handlers[0], Depfile::dependencies(tmpl));
+    depfile_path = tmpl.handlers[0].get_output_path() + ".d";
+    text = utils::fs::readfile(depfile_path);
+    BOOST_ASSERT(text == tmpl.handlers[0].get_output_path() + ": \\\n"
+                         "  tests/yaml/countrytmpl.yaml \\\n"
+                         "  tests/xlsx/sample.xlsx \\\n"
+                         "  tests/template.py\n");
+    std::remove(depfile_path.c_str());
+    ::rmdir(dir);
+
+    utils::log("depfile: ok");
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <boost/assert.hpp>
+#include <cstdio>
+#include "utils.hpp"
+#include "xlsx.hpp"
+#include "arg_config.hpp"
+#include "yaml_config.hpp"
+#include "manifest.hpp"
+
+// --incremental: which changes to the inputs and outputs make a target stale.
+using Entries = std::vector<std::pair<std::string, std::string>>;  // name, contents
+
+std::string le(uint32_t v, int n) {
+    std::string out;
+    for (int i = 0; i < n; ++i) out.push_back(static_cast<char>(v >> (i * 8)));
+    return out;
+}
+
+void write_zip(const std::string& path, const Entries& entries) {
+    // stored entries.
+    std::string zip, cd;
+    for (auto& entry : entries) {
+        auto& data = entry.second;
+        uint32_t crc = crc32(0, reinterpret_cast<const Bytef*>(data.data()), data.size());
+        auto fields = le(20, 2) + le(0, 2) + le(0, 2) + le(0, 4) + le(crc, 4) +
+                      le(data.size(), 4) + le(data.size(), 4) + le(entry.first.size(), 2) +
+                      le(0, 2);
+        cd += le(0x02014b50, 4) + le(20, 2) + fields + le(0, 2) + le(0, 2) + le(0, 2) +
+              le(0, 4) + le(zip.size(), 4) + entry.first;
+        zip += le(0x04034b50, 4) + fields + entry.first + data;
+    }
+    zip += cd + le(0x06054b50, 4) + le(0, 2) + le(0, 2) + le(entries.size(), 2) +
+           le(entries.size(), 2) + le(cd.size(), 4) + le(zip.size(), 4) + le(0, 2);
+    xlsxconverter::utils::fs::writefile(path, zip);
+}
+
+std::string& contents(Entries& entries, const std::string& name) {
+    for (auto& entry : entries) {
+        if (entry.first == name) return entry.second;
+    }
+    BOOST_ASSERT(false);
+    return entries[0].second;
+}
+
+int main(int argc, char** argv) {
+    using namespace xlsxconverter;
+
+    char dir[] = "/tmp/test_manifest_XXXXXX";
+    BOOST_ASSERT(mkdtemp(dir) != nullptr);
+    auto xls_dir = utils::fs::joinpath(dir, "xlsx");
+    auto yaml_dir = utils::fs::joinpath(dir, "yaml");
+    auto out_dir = utils::fs::joinpath(dir, "out");
+    utils::fs::mkdirp(xls_dir);
+    utils::fs::mkdirp(yaml_dir);
+    utils::fs::mkdirp(out_dir);
+
+    // dummy1lua.yaml reads sample.xlsx#dummy1, and country.yaml reads its 都道府県 sheet.
+    for (auto name : {"dummy1lua.yaml", "country.yaml"}) {
+        utils::fs::writefile(utils::fs::joinpath(yaml_dir, name),
+                             utils::fs::readfile(utils::fs::joinpath("tests/yaml", name)));
+    }
+    Entries entries;
+    std::string target_sheet, relation_sheet;
+    {
+        xlsx::Workbook book("tests/xlsx/sample.xlsx");
+        for (size_t i = 0; i < book.archive->size(); ++i) {
+            auto& entry = book.archive->entry(i);
+            std::string data(entry.size, '\0');
+            if (!data.empty()) book.archive->read_entry(i, &data[0], data.size());
+            entries.emplace_back(entry.name, data);
+        }
+        target_sheet = book.rels[book.sheet_rid_by_name["dummy1"]];
+        relation_sheet = book.rels[book.sheet_rid_by_name["都道府県"]];
+    }
+    auto xls_path = utils::fs::joinpath(xls_dir, "sample.xlsx");
+    write_zip(xls_path, entries);
+
+    std::vector<std::string> args = {"xlsxconverter", "--incremental",
+                                     "--xls_search_path", xls_dir,
+                                     "--yaml_search_path", yaml_dir,
+                                     "--output_base_path", out_dir};
+    std::vector<char*> argv_;
+    for (auto& arg : args) argv_.push_back(&arg[0]);
+    ArgConfig arg_config(argv_.size(), argv_.data());
+    auto output_path = utils::fs::joinpath(out_dir, "dummy1lua.lua");
+
+    auto build = [&]() {
+        // true: skipped. otherwise the output is written and recorded, as a conversion does.
+        Manifest manifest(arg_config);
+        YamlConfig yaml_config("dummy1lua.yaml", arg_config);
+        bool up_to_date = manifest.check(yaml_config);
+        if (!up_to_date) {
+            utils::fs::writefile(output_path, "output");
+            manifest.record(yaml_config);
+        }
+        manifest.save();
+        return up_to_date;
+    };
+    auto replace = [](std::string& s, const std::string& from, const std::string& to) {
+        auto pos = s.find(from);
+        BOOST_ASSERT(pos != std::string::npos);
+        s.replace(pos, from.size(), to);
+    };
+
+    BOOST_ASSERT(!build());
+    BOOST_ASSERT(build());
+
+    // the workbook is rewritten with the same contents.
+    write_zip(xls_path, entries);
+    BOOST_ASSERT(build());
+
+    // the output is deleted.
+    std::remove(output_path.c_str());
+    BOOST_ASSERT(!build());
+    BOOST_ASSERT(build());
+
+    // the target sheet changes.
+    replace(contents(entries, target_sheet), "</worksheet>", " </worksheet>");
+    write_zip(xls_path, entries);
+    BOOST_ASSERT(!build());
+    BOOST_ASSERT(build());
+
+    // a string is appended. the sheets cant refer to it.
+    replace(contents(entries, "xl/sharedStrings.xml"), "</sst>", "<si><t>appended</t></si></sst>");
+    write_zip(xls_path, entries);
+    BOOST_ASSERT(build());
+
+    // a string the sheets can refer to changes.
+    replace(contents(entries, "xl/sharedStrings.xml"), "<t>", "<t>changed");
+    write_zip(xls_path, entries);
+    BOOST_ASSERT(!build());
+    BOOST_ASSERT(build());
+
+    // the sheet of the relation changes.
+    replace(contents(entries, relation_sheet), "</worksheet>", " </worksheet>");
+    write_zip(xls_path, entries);
+    BOOST_ASSERT(!build());
+    BOOST_ASSERT(build());
+
+    // the relation yaml changes.
+    auto country_path = utils::fs::joinpath(yaml_dir, "country.yaml");
+    utils::fs::writefile(country_path, utils::fs::readfile(country_path) + "\n# edited\n");
+    BOOST_ASSERT(!build());
+    BOOST_ASSERT(build());
+
+    for (auto name : {"yaml/dummy1lua.yaml", "yaml/country.yaml", "xlsx/sample.xlsx",
+                      "out/dummy1lua.lua", "out/.xlsxconverter_manifest"}) {
+        std::remove(utils::fs::joinpath(dir, name).c_str());
+    }
+    for (auto name : {"yaml", "xlsx", "out", ""}) ::rmdir(utils::fs::joinpath(dir, name).c_str());
+
+    utils::log("manifest: ok");
+    return 0;
+}
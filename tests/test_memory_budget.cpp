@@ -0,0 +1,58 @@
+#include <boost/assert.hpp>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "utils.hpp"
+
+// --max_memory admission: shared keys, oversized work, and waiting for a release.
+int main(int argc, char** argv) {
+    using namespace xlsxconverter;
+    using Items = utils::memory_budget::Items;
+
+    utils::memory_budget budget(100);
+    Items a = {{"a.xlsx", 60}};
+    Items b = {{"b.xlsx", 50}};
+    Items ab = {{"a.xlsx", 60}, {"b.xlsx", 50}};
+
+    // a key held by several works is charged once, until the last release.
+    BOOST_ASSERT(budget.acquire(a, false));
+    BOOST_ASSERT(budget.acquire(a, false));
+    BOOST_ASSERT(budget.used == 60);
+    BOOST_ASSERT(!budget.acquire(b, false));
+    BOOST_ASSERT(!budget.acquire(ab, false));
+    budget.release(a);
+    BOOST_ASSERT(budget.used == 60);
+    BOOST_ASSERT(!budget.acquire(b, false));
+    budget.release(a);
+    BOOST_ASSERT(budget.used == 0 && budget.held.empty());
+
+    // work larger than the limit is admitted when nothing is held, and runs alone.
+    Items huge = {{"huge.xlsx", 500}};
+    BOOST_ASSERT(budget.acquire(huge, false));
+    BOOST_ASSERT(budget.used == 500);
+    BOOST_ASSERT(!budget.acquire(b, false));
+    budget.release(huge);
+    BOOST_ASSERT(budget.acquire(ab, false));
+    BOOST_ASSERT(budget.used == 110);
+    budget.release(ab);
+    BOOST_ASSERT(budget.used == 0);
+
+    // a waiting acquire is woken by the release that makes room.
+    BOOST_ASSERT(budget.acquire(a, false));
+    std::atomic<bool> admitted(false);
+    std::thread waiter([&]() {
+        budget.acquire(b, true);
+        admitted = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BOOST_ASSERT(!admitted.load());
+    budget.release(a);
+    waiter.join();
+    BOOST_ASSERT(admitted.load());
+    BOOST_ASSERT(budget.used == 50);
+    budget.release(b);
+    BOOST_ASSERT(budget.used == 0);
+
+    utils::log("memory_budget: ok");
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <boost/assert.hpp>
+#include <random>
+#include "utils.hpp"
+#include "xlsx.hpp"
+
+// Cell::parse_number must type and parse cells as is_float_string() and strtoll/strtod did.
+bool check(const std::string& s) {
+    using Type = xlsx::Cell::Type;
+    xlsx::Cell::Value expected, value;
+    Type expected_type;
+    if (xlsx::Cell::is_float_string(s)) {
+        expected_type = Type::kDouble;
+        expected.d = std::strtod(s.c_str(), nullptr);
+    } else {
+        expected_type = Type::kInt;
+        expected.i = std::strtoll(s.c_str(), nullptr, 10);
+    }
+    auto type = xlsx::Cell::parse_number(s.c_str(), s.size(), value);
+    bool ok = type == expected_type && std::memcmp(&value, &expected, sizeof(value)) == 0;
+    if (!ok) {
+        xlsxconverter::utils::log("parse_number: [", s, "] type=", static_cast<int>(type),
+                                  " expected=", static_cast<int>(expected_type));
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    using namespace xlsxconverter;
+
+    int errors = 0;
+    for (auto s : {"0", "-0", "12", "-12", "+7", "0.25", "1.5E-05", "1e5", "1E", "1E+", ".", "-.5",
+                   "1.", "", "-", " 1", "1.5.5", "0.30000000000000004", "123456789012345678",
+                   "1234567890123456789", "99999999999999999999", "43000.5",
+                   "-1.7976931348623157E+308", "4.9406564584124654E-324"}) {
+        if (!check(s)) errors++;
+    }
+    // numbers as excel writes them, and random text.
+    std::mt19937_64 rng(1);
+    const char* fmts[] = {"%.15g", "%.17g", "%.2f", "%.10E"};
+    const char* chars = "0123456789.eE+- ";
+    for (int k = 0; k < 200000; ++k) {
+        char buf[64];
+        double x = std::ldexp(static_cast<double>(rng() >> 11), -static_cast<int>(rng() % 80));
+        std::snprintf(buf, sizeof(buf), fmts[k % 4], x);
+        if (!check(buf)) errors++;
+        std::string s;
+        for (int i = 1 + rng() % 12; i > 0; --i) s.push_back(chars[rng() % 16]);
+        if (!check(s)) errors++;
+    }
+    utils::log("parse_number errors: ", errors);
+    BOOST_ASSERT(errors == 0);
+    return 0;
+}
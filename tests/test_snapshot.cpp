@@ -0,0 +1,67 @@
+#include <boost/assert.hpp>
+#include <cstdio>
+#include "utils.hpp"
+#include "xlsx.hpp"
+
+// decoded sheet snapshots: saved, mapped by a later workbook, and dropped when stale.
+int main(int argc, char** argv) {
+    using namespace xlsxconverter;
+    using Type = xlsx::Cell::Type;
+
+    char dir[] = "/tmp/test_snapshot_XXXXXX";
+    BOOST_ASSERT(mkdtemp(dir) != nullptr);
+    const char* path = "tests/xlsx/sample.xlsx";
+    const char* sheet_name = "dummy1";
+
+    xlsx::Workbook plain(path);
+    auto& expected = plain.sheet_by_name(sheet_name);
+    expected.preload(1);
+
+    xlsx::snapshot_dir() = dir;
+    int mismatches = 0;
+    for (int k = 0; k < 2; ++k) {
+        // first: decoded and saved. second: mapped.
+        xlsx::Workbook book(path);
+        auto& sheet = book.sheet_by_name(sheet_name);
+        BOOST_ASSERT((sheet.snapshot_ != nullptr) == (k == 1));
+        BOOST_ASSERT(!book.streamable());
+        BOOST_ASSERT(sheet.nrows() == expected.nrows() && sheet.ncols() == expected.ncols());
+        for (int rowx = 0; rowx < sheet.nrows(); ++rowx) {
+            BOOST_ASSERT(sheet.slot(rowx) == expected.slot(rowx));
+            for (int colx = 0; colx < sheet.ncols(); ++colx) {
+                auto a = sheet.cell(rowx, colx);
+                auto b = expected.cell(rowx, colx);
+                bool same = a.type == b.type;
+                if (same && a.type != Type::kEmpty) {
+                    same = a.as_str() == b.as_str() &&
+                           std::memcmp(&a.value, &b.value, sizeof(a.value)) == 0;
+                }
+                if (!same) {
+                    utils::log("snapshot: ", a.cellname(), " [", a.as_str(), "]");
+                    mismatches++;
+                }
+            }
+        }
+    }
+
+    // stale: another mtime, or a broken file.
+    xlsx::Workbook book(path);
+    xlsx::Snapshot::Key key{book.path, sheet_name, book.file_size, book.mtime, book.content_hash};
+    BOOST_ASSERT(xlsx::Snapshot::load(key, "rid") != nullptr);
+    auto stale = key;
+    stale.mtime++;
+    BOOST_ASSERT(xlsx::Snapshot::load(stale, "rid") == nullptr);
+    auto snapshot_path = xlsx::Snapshot::path(key);
+    struct stat statbuf;
+    BOOST_ASSERT(::stat(snapshot_path.c_str(), &statbuf) == 0);
+    BOOST_ASSERT(::truncate(snapshot_path.c_str(), statbuf.st_size - 1) == 0);
+    BOOST_ASSERT(xlsx::Snapshot::load(key, "rid") == nullptr);
+
+    std::remove(snapshot_path.c_str());
+    std::remove((snapshot_path + ".lock").c_str());
+    ::rmdir(dir);
+
+    utils::log("snapshot mismatches: ", mismatches);
+    BOOST_ASSERT(mismatches == 0);
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <boost/assert.hpp>
+#include <random>
+#include "utils.hpp"
+#include "xlsx.hpp"
+
+// BIFF12 kernels of the xlsb reader.
+std::string record(int type, const std::string& data) {
+    std::string out;
+    for (int t = type;;) {
+        out.push_back((t & 0x7f) | (t > 0x7f ? 0x80 : 0));
+        if ((t >>= 7) == 0) break;
+    }
+    for (size_t n = data.size();;) {
+        out.push_back((n & 0x7f) | (n > 0x7f ? 0x80 : 0));
+        if ((n >>= 7) == 0) break;
+    }
+    return out + data;
+}
+
+std::string u32(uint32_t v) {
+    return std::string({char(v), char(v >> 8), char(v >> 16), char(v >> 24)});
+}
+
+std::string wide(const std::u16string& s) {
+    std::string out = u32(s.size());
+    for (auto c : s) {
+        out.push_back(c & 0xff);
+        out.push_back(c >> 8);
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    using namespace xlsxconverter;
+    namespace xb = xlsx::xlsb;
+    using Type = xlsx::Cell::Type;
+
+    // records: 2 byte type, 2 byte size.
+    auto data = record(xb::kBeginCellXFs, std::string(300, 'x')) + record(xb::kRowHdr, u32(7));
+    const char* p = data.data();
+    const char* end = p + data.size();
+    xb::Record r;
+    BOOST_ASSERT(xb::next_record(p, end, r) == 1 && r.type == 617 && r.size == 300);
+    BOOST_ASSERT(xb::next_record(p, end, r) == 1 && r.type == 0 && xb::le32(r.data) == 7);
+    BOOST_ASSERT(xb::next_record(p, end, r) == 0);
+    p = data.data();
+    end = p + 100;
+    BOOST_ASSERT(xb::next_record(p, end, r) == -1);
+
+    // utf-16: a pair, and a lone surrogate.
+    auto s = wide({u'a', 0x3042, 0xd83d, 0xde00, 0xd800, u'z'});
+    p = s.data();
+    std::string text;
+    BOOST_ASSERT(xb::read_string(p, s.data() + s.size(), text));
+    BOOST_ASSERT(text == "a\xe3\x81\x82\xf0\x9f\x98\x80\xef\xbf\xbdz");
+    BOOST_ASSERT(p == s.data() + s.size());
+    p = s.data();
+    BOOST_ASSERT(!xb::read_string(p, s.data() + s.size() - 1, text));
+
+    // rk: int30, x100, and the high bits of a double.
+    BOOST_ASSERT(xb::rk_number((123 << 2) | 2) == 123);
+    BOOST_ASSERT(xb::rk_number(static_cast<uint32_t>(-5) << 2 | 2) == -5);
+    BOOST_ASSERT(xb::rk_number((1234 << 2) | 3) == 12.34);
+    BOOST_ASSERT(xb::rk_number(0x3ff80000) == 1.5);
+
+    // numbers are typed by CellTable::set as the <v> text excel writes.
+    int errors = 0;
+    std::mt19937_64 rng(1);
+    for (int k = 0; k < 200000; ++k) {
+        double d;
+        if (k % 2) {
+            d = static_cast<double>(static_cast<int64_t>(rng() >> (rng() % 64))) / 4;
+        } else {
+            d = std::ldexp(static_cast<double>(rng() >> 11), -static_cast<int>(rng() % 80));
+        }
+        std::string v;
+        xb::format_number(d, v);
+        xlsx::Cell::Value value;
+        auto type = xlsx::Cell::parse_number(v.c_str(), v.size(), value);
+        double parsed = type == Type::kInt ? static_cast<double>(value.i) : value.d;
+        bool integral = v.find_first_of(".E") == std::string::npos;
+        if (parsed != d || (type == Type::kInt) != integral) {
+            utils::log("format_number: ", v, " type=", static_cast<int>(type));
+            errors++;
+        }
+    }
+    std::string v;
+    xb::format_number(12.0, v);
+    BOOST_ASSERT(v == "12");
+    v.clear();
+    xb::format_number(1e-5, v);
+    BOOST_ASSERT(v == "1E-05");
+    // integral: digits as long as int64 holds them, as xlsx gives an int cell.
+    xlsx::Cell::Value value;
+    v.clear();
+    xb::format_number(1e15, v);
+    BOOST_ASSERT(v == "1000000000000000");
+    BOOST_ASSERT(xlsx::Cell::parse_number(v.c_str(), v.size(), value) == Type::kInt);
+    BOOST_ASSERT(value.i == 1000000000000000LL);
+    v.clear();
+    xb::format_number(-std::ldexp(1.0, 62), v);
+    BOOST_ASSERT(v == "-4611686018427387904");
+    BOOST_ASSERT(xlsx::Cell::parse_number(v.c_str(), v.size(), value) == Type::kInt);
+    BOOST_ASSERT(value.i == -(1LL << 62));
+    v.clear();
+    xb::format_number(-0.0, v);
+    BOOST_ASSERT(v == "0");
+    v.clear();
+    xb::format_number(1e19, v);
+    BOOST_ASSERT(v == "1E+19");
+    BOOST_ASSERT(xlsx::Cell::parse_number(v.c_str(), v.size(), value) == Type::kDouble);
+
+    // cells.
+    int colx, style;
+    const char* t;
+    auto cell = record(xb::kCellIsst, u32(3) + u32(0x01000005) + u32(42));
+    p = cell.data();
+    BOOST_ASSERT(xb::next_record(p, cell.data() + cell.size(), r) == 1);
+    BOOST_ASSERT(xb::read_cell(r, colx, style, v, t));
+    BOOST_ASSERT(colx == 3 && style == 5 && v == "42" && std::string(t) == "s");
+    cell = record(xb::kFmlaError, u32(0) + u32(0) + std::string(1, 0x07) + std::string(2, 0));
+    p = cell.data();
+    BOOST_ASSERT(xb::next_record(p, cell.data() + cell.size(), r) == 1);
+    BOOST_ASSERT(xb::read_cell(r, colx, style, v, t));
+    BOOST_ASSERT(v == "#DIV/0!" && std::string(t) == "e");
+
+    // styles: cellStyleXfs are not cell formats.
+    auto styles = record(xb::kFmt, std::string({char(164), 0}) + wide(u"yyyy/m/d")) +
+                  record(626, u32(1)) + record(xb::kXF, std::string({-1, -1, 14, 0})) +
+                  record(627, "") +
+                  record(xb::kBeginCellXFs, u32(2)) +
+                  record(xb::kXF, std::string({-1, -1, 0, 0})) +
+                  record(xb::kXF, std::string({-1, -1, char(164), 0})) +
+                  record(xb::kEndCellXFs, "");
+    xlsx::StyleSheet style_sheet([&](xlsx::StyleSheet& ss) {
+        ss.parse(styles.data(), styles.size());
+    });
+    BOOST_ASSERT(!style_sheet.is_date_format(0));
+    BOOST_ASSERT(style_sheet.is_date_format(1));
+    BOOST_ASSERT(!style_sheet.is_date_format(2));
+
+    // shared strings.
+    auto sst = record(159, u32(2) + u32(2)) +
+               record(xb::kSSTItem, std::string(1, 0) + wide(u"foo")) +
+               record(xb::kSSTItem, std::string(1, 1) + wide(u"bar") + std::string(6, 0)) +
+               record(160, "");
+    xlsx::SharedStrings strings([&](xlsx::SharedStrings& ss) {
+        ss.assign_binary(sst.data(), sst.size());
+    });
+    BOOST_ASSERT(strings.size() == 2);
+    BOOST_ASSERT(strings.at(0) == "foo" && strings.at(1) == "bar");
+
+    utils::log("format_number errors: ", errors);
+    BOOST_ASSERT(errors == 0);
+    return 0;
+}
@@ -13,7 +13,7 @@ int main(int argc, char** argv) {
     utils::log("nrows: ", sheet.nrows());
     for (int j = 0; j < sheet.nrows(); ++j) {
         for (int i = 0; i < sheet.ncols(); ++i) {
-            auto& cell = sheet.cell(j, i);
+            auto cell = sheet.cell(j, i);
             if (cell.type == xlsx::Cell::Type::kEmpty) continue;
             utils::log("cell[", cell.cellname(), "]=", cell.as_str());
         }
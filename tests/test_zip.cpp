@@ -0,0 +1,196 @@
+#include <boost/assert.hpp>
+#include <thread>
+#include <atomic>
+#include <random>
+#include "utils.hpp"
+#include "xlsx.hpp"
+
+// many threads read entries of one archive at the same time.
+void stress(const std::string& path, bool use_mmap) {
+    using namespace xlsxconverter;
+
+    xlsx::ZipReader reader(path, use_mmap);
+    BOOST_ASSERT(reader.size() > 0);
+
+    // expected contents, read by one thread.
+    std::vector<std::string> expected;
+    for (int i = 0; i < reader.size(); ++i) {
+        std::string data(reader.entry(i).size, '\0');
+        if (!data.empty()) reader.read_entry(i, &data[0], data.size());
+        BOOST_ASSERT(crc32(0, reinterpret_cast<const Bytef*>(data.data()), data.size())
+                     == reader.entry(i).crc32);
+        expected.push_back(data);
+        // stored entries are zero-copy views on the mapping.
+        auto view = reader.view(i);
+        if (view != nullptr) {
+            BOOST_ASSERT(reader.entry(i).method == 0);
+            BOOST_ASSERT(std::string(view, reader.entry(i).size) == data);
+        }
+    }
+
+    const int nthreads = 16;
+    const int niters = 200;
+    std::atomic<int> errors(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int k = 0; k < niters; ++k) {
+                int i = (t * 7 + k) % reader.size();
+                std::string data(reader.entry(i).size, '\0');
+                if (k % 2 == 0) {
+                    if (!data.empty()) reader.read_entry(i, &data[0], data.size());
+                } else {
+                    // small chunks, to interleave with the other threads.
+                    auto stream = reader.stream(i);
+                    size_t pos = 0;
+                    while (pos < data.size()) {
+                        auto n = stream->read(&data[pos], std::min<size_t>(97, data.size() - pos));
+                        if (n == 0) break;
+                        pos += n;
+                    }
+                }
+                if (data != expected[i]) errors++;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    utils::log(path, (reader.mapped() ? " (mmap)" : " (pread)"),
+               " entries: ", reader.size(), " reads: ", nthreads * niters,
+               " errors: ", errors.load());
+    BOOST_ASSERT(errors.load() == 0);
+}
+
+std::string deflate_raw(const std::string& data, int level, int strategy) {
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    BOOST_ASSERT(deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) == Z_OK);
+    std::string out(deflateBound(&zs, data.size()), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = data.size();
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = out.size();
+    BOOST_ASSERT(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+// the inflaters give the same result for data deflated by zlib, truncated, or corrupt.
+void roundtrip() {
+    using namespace xlsxconverter;
+
+    std::mt19937 rng(1);
+    std::vector<std::string> inputs = {"", "a"};
+    std::string xml;
+    for (int i = 0; xml.size() < 300000; ++i) {
+        xml += utils::sscat("<c r=\"A", i, "\" s=\"", rng() % 5, "\"><v>", rng() % 100000,
+                            "</v></c>");
+    }
+    inputs.push_back(xml);
+    std::string random(100000, '\0');
+    for (auto& c : random) c = static_cast<char>(rng());
+    inputs.push_back(random);
+    inputs.push_back(std::string(200000, '\0'));
+    inputs.push_back(xml.substr(0, 50000) + random.substr(0, 50000) + xml.substr(0, 50000));
+
+    xlsx::FastInflater fast;
+    xlsx::ZlibInflater zlib;
+    int errors = 0;
+    int ncases = 0;
+    // true: inflated.
+    auto check = [&](const std::string& in, const std::string& expected, bool valid) {
+        std::string a(expected.size(), '\0');
+        std::string b(expected.size(), '\0');
+        bool ok_a = fast.inflate(in.data(), in.size(), &a[0], a.size());
+        bool ok_b = zlib.inflate(in.data(), in.size(), &b[0], b.size());
+        bool same = ok_a == ok_b && (!ok_a || a == b);
+        if (valid) same = same && ok_a && a == expected;
+        if (!same) {
+            utils::log("roundtrip: in=", in.size(), " out=", expected.size(),
+                       " fast=", ok_a, " zlib=", ok_b);
+            errors++;
+        }
+        ncases++;
+        return ok_a;
+    };
+    const int strategies[] = {Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE, Z_FIXED};
+    for (auto& input : inputs) {
+        for (int level : {0, 1, 6, 9}) {
+            for (int strategy : strategies) {
+                auto deflated = deflate_raw(input, level, strategy);
+                check(deflated, input, true);
+                // truncated: nothing is inflated past the end of input.
+                for (size_t n : {size_t(0), size_t(1), deflated.size() / 2, deflated.size() - 1}) {
+                    if (n >= deflated.size()) continue;
+                    if (check(deflated.substr(0, n), input, false)) errors++;
+                }
+                // corrupt: flipped bits.
+                for (int k = 0; k < 20; ++k) {
+                    auto corrupt = deflated;
+                    corrupt[rng() % corrupt.size()] ^= static_cast<char>(1 << (rng() % 8));
+                    check(corrupt, input, false);
+                }
+            }
+        }
+    }
+    utils::log("roundtrip cases: ", ncases, " errors: ", errors);
+    BOOST_ASSERT(errors == 0);
+}
+
+std::string le(uint32_t v, int n) {
+    std::string out;
+    for (int i = 0; i < n; ++i) out.push_back(static_cast<char>(v >> (i * 8)));
+    return out;
+}
+
+// an entry whose contents do not match the crc32 of the central directory.
+void crc_mismatch() {
+    using namespace xlsxconverter;
+
+    std::string data(10000, 'x');
+    auto deflated = deflate_raw(data, 6, Z_DEFAULT_STRATEGY);
+    uint32_t crc = crc32(0, reinterpret_cast<const Bytef*>(data.data()), data.size()) ^ 1;
+    std::string name = "a.xml";
+    auto fields = le(20, 2) + le(0, 2) + le(8, 2) + le(0, 4) + le(crc, 4) +
+                  le(deflated.size(), 4) + le(data.size(), 4) + le(name.size(), 2) + le(0, 2);
+    auto zip = le(0x04034b50, 4) + fields + name + deflated;
+    auto cd = le(0x02014b50, 4) + le(20, 2) + fields + le(0, 2) + le(0, 2) + le(0, 2) +
+              le(0, 4) + le(0, 4) + name;
+    zip += cd + le(0x06054b50, 4) + le(0, 2) + le(0, 2) + le(1, 2) + le(1, 2) +
+           le(cd.size(), 4) + le(zip.size(), 4) + le(0, 2);
+    std::string path = "/tmp/test_zip_crc.zip";
+    utils::fs::writefile(path, zip);
+
+    for (bool use_mmap : {true, false}) {
+        xlsx::ZipReader reader(path, use_mmap);
+        BOOST_ASSERT(reader.size() == 1 && reader.entry(0).crc32 == crc);
+        std::string out(data.size(), '\0');
+        bool thrown = false;
+        try {
+            reader.read_entry(0, &out[0], out.size());
+        } catch (xlsx::Exception&) {
+            thrown = true;
+        }
+        BOOST_ASSERT(thrown);
+        thrown = false;
+        try {
+            auto stream = reader.stream(0);
+            while (stream->read(&out[0], 1000) > 0) {}
+        } catch (xlsx::Exception&) {
+            thrown = true;
+        }
+        BOOST_ASSERT(thrown);
+    }
+    std::remove(path.c_str());
+    utils::log("crc mismatch: detected");
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "tests/xlsx/sample.xlsx";
+    roundtrip();
+    crc_mismatch();
+    stress(path, true);
+    stress(path, false);
+    return 0;
+}